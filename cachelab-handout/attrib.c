@@ -0,0 +1,187 @@
+/*
+ * attrib.c - Attribution of L1 misses to regions, sets and pages
+ *
+ *  Misses and the evictions they cause are counted in three ways:
+ *  	by named address region, such as the A and B arrays
+ *  	by set index, which exposes the conflict hot sets
+ *  	by 4K page, in a hash table grown as pages show up
+ *  Only misses are looked at, so hits cost nothing. The report is
+ *  one JSON object: a list of regions, then sets as [set, misses,
+ *  evictions] and pages as [base, misses, evictions], both sorted by
+ *  misses.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "attrib.h"
+
+struct Counts {
+	unsigned long misses;
+	unsigned long evictions;
+};
+
+struct Region {
+	char name[32];
+	unsigned long base, size;
+	struct Counts counts;
+};
+
+struct Page {
+	unsigned long page;       /* page number plus one, 0 marks an empty slot */
+	struct Counts counts;
+};
+
+int attribFlag = 0;
+
+static struct Region regions[MAX_REGIONS + 1];
+static int regionNum = 0;
+static struct Counts *setCounts = NULL;
+static struct Page *pages = NULL;
+static size_t pageCap = 0, pageNum = 0;
+static int attribS = 0, attribB = 0;
+static char *attribPath = NULL;
+
+/* add a named region "name:base:size", base and size in hex */
+void attribAddRegion(char *spec) {
+	struct Region *r = &regions[regionNum];
+	if(regionNum == MAX_REGIONS ||
+		sscanf(spec, "%31[^:]:%lx:%lx", r->name, &r->base, &r->size) != 3) {
+		printf("Error: Bad region %s, expected name:base:size (at most %d)\n", spec, MAX_REGIONS);
+		exit(-1);
+	}
+	regionNum++;
+}
+
+/* start attributing the misses of a cache with 2^s sets and 2^b byte blocks */
+void attribInit(int s, int b, char *path) {
+	attribS = s;
+	attribB = b;
+	attribPath = path;
+	strcpy(regions[regionNum].name, "other");
+	setCounts = (struct Counts*)calloc((size_t)1 << s, sizeof(struct Counts));
+	pageCap = 1024;
+	pages = (struct Page*)calloc(pageCap, sizeof(struct Page));
+	if(!setCounts || !pages) {
+		printf("Error: Cann't allocate attribution tables!\n");
+		exit(-1);
+	}
+	attribFlag = 1;
+}
+
+static inline size_t pageSlot(struct Page *table, size_t cap, unsigned long key) {
+	size_t i = (key * 0x9e3779b97f4a7c15UL) & (cap - 1);
+	while(table[i].page && table[i].page != key) {
+		i = (i + 1) & (cap - 1);
+	}
+	return i;
+}
+
+/* double the page table once it is half full */
+static void growPages(void) {
+	size_t cap = pageCap * 2;
+	struct Page *table = (struct Page*)calloc(cap, sizeof(struct Page));
+	if(!table) {
+		printf("Error: Cann't allocate attribution tables!\n");
+		exit(-1);
+	}
+	for(size_t i = 0; i < pageCap; i++) {
+		if(pages[i].page) {
+			table[pageSlot(table, cap, pages[i].page)] = pages[i];
+		}
+	}
+	free(pages);
+	pages = table;
+	pageCap = cap;
+}
+
+static inline void count(struct Counts *c, int eviction) {
+	c->misses++;
+	c->evictions += eviction;
+}
+
+/* count a miss at address, and the eviction it caused if any */
+void attribMiss(unsigned long address, int eviction) {
+	int r = 0;
+	while(r < regionNum && address - regions[r].base >= regions[r].size) {
+		r++;
+	}
+	count(&regions[r].counts, eviction);
+	count(&setCounts[(address >> attribB) & ((1UL << attribS) - 1)], eviction);
+
+	unsigned long key = (address >> PAGE_BITS) + 1;
+	size_t i = pageSlot(pages, pageCap, key);
+	if(!pages[i].page) {
+		if(2 * (pageNum + 1) > pageCap) {
+			growPages();
+			i = pageSlot(pages, pageCap, key);
+		}
+		pages[i].page = key;
+		pageNum++;
+	}
+	count(&pages[i].counts, eviction);
+}
+
+static int byMisses(const void *x, const void *y) {
+	const struct Page *p = x, *q = y;
+	if(p->counts.misses != q->counts.misses) {
+		return p->counts.misses < q->counts.misses ? 1 : -1;
+	}
+	return p->page < q->page ? -1 : p->page > q->page;
+}
+
+/* write the report as JSON to the path given to attribInit */
+void attribReport(void) {
+	FILE *fp = fopen(attribPath, "w");
+	if(!fp) {
+		printf("Error: Cann't open file %s!\n", attribPath);
+		exit(-1);
+	}
+
+	fprintf(fp, "{\n\"regions\": [");
+	for(int r = 0; r <= regionNum; r++) {
+		fprintf(fp, "%s\n  {\"name\": \"%s\", \"base\": \"0x%lx\", \"misses\": %lu, \"evictions\": %lu}",
+			r ? "," : "", regions[r].name, regions[r].base,
+			regions[r].counts.misses, regions[r].counts.evictions);
+	}
+
+	/* sets and pages share the page layout so one sort serves both */
+	size_t numSets = (size_t)1 << attribS, n = 0;
+	struct Page *sorted = (struct Page*)malloc((numSets > pageNum ? numSets : pageNum + 1) * sizeof(struct Page));
+	if(!sorted) {
+		printf("Error: Cann't allocate attribution tables!\n");
+		exit(-1);
+	}
+	for(size_t i = 0; i < numSets; i++) {
+		if(setCounts[i].misses) {
+			sorted[n].page = i;
+			sorted[n++].counts = setCounts[i];
+		}
+	}
+	qsort(sorted, n, sizeof(struct Page), byMisses);
+	fprintf(fp, "\n],\n\"sets\": [");
+	for(size_t i = 0; i < n; i++) {
+		fprintf(fp, "%s\n  [%lu, %lu, %lu]", i ? "," : "", sorted[i].page,
+			sorted[i].counts.misses, sorted[i].counts.evictions);
+	}
+
+	n = 0;
+	for(size_t i = 0; i < pageCap; i++) {
+		if(pages[i].page) {
+			sorted[n] = pages[i];
+			sorted[n++].page--;
+		}
+	}
+	qsort(sorted, n, sizeof(struct Page), byMisses);
+	fprintf(fp, "\n],\n\"pages\": [");
+	for(size_t i = 0; i < n; i++) {
+		fprintf(fp, "%s\n  [\"0x%lx\", %lu, %lu]", i ? "," : "", sorted[i].page << PAGE_BITS,
+			sorted[i].counts.misses, sorted[i].counts.evictions);
+	}
+	fprintf(fp, "\n]\n}\n");
+	fclose(fp);
+
+	free(sorted);
+	free(setCounts);
+	free(pages);
+}
@@ -0,0 +1,26 @@
+/*
+ * attrib.h - Attribution of L1 misses to regions, sets and pages
+ */
+
+#ifndef CACHELAB_ATTRIB_H
+#define CACHELAB_ATTRIB_H
+
+#define MAX_REGIONS 16
+#define PAGE_BITS 12
+
+/* set by attribInit, misses are only attributed when it is on */
+extern int attribFlag;
+
+/* add a named region "name:base:size", base and size in hex */
+void attribAddRegion(char *spec);
+
+/* start attributing the misses of a cache with 2^s sets and 2^b byte blocks */
+void attribInit(int s, int b, char *path);
+
+/* count a miss at address, and the eviction it caused if any */
+void attribMiss(unsigned long address, int eviction);
+
+/* write the report as JSON to the path given to attribInit */
+void attribReport(void);
+
+#endif /* CACHELAB_ATTRIB_H */
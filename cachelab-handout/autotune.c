@@ -0,0 +1,253 @@
+/*
+ * autotune.c - Search the blocked transpose's parameters for the ones
+ *     that miss least in a given cache.
+ *
+ * Every combination of tile height, tile width, tile order and diagonal
+ * handling is run on the instrumented trans.c (see tracemem.h) with its
+ * accesses to A and B going into the cache model, the same way
+ * test-trans -i scores functions. The best parameters for each shape
+ * are printed and, with -o, written out as the trans-tuned.h table that
+ * transpose_tuned() in trans.c looks up.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "trans-params.h"
+#include "cache.h"
+#include "tracemem.h"
+
+/* Maximum array dimension */
+#define MAXN 256
+
+/* Maximum number of shapes in one run */
+#define MAX_SHAPES 16
+
+/* How many of the best candidates to show per shape */
+#define SHOW_BEST 5
+
+/* Matrices laid out as in tracegen, and the cache they are scored in */
+static int A[MAXN][MAXN];
+static int B[MAXN][MAXN];
+static struct Cache tune_cache;
+
+/* A candidate and its score */
+struct candidate {
+    struct trans_params p;
+    int misses;
+    int hits;
+    int evictions;
+};
+
+static const char *diag_names[] = {"none", "defer", "locals"};
+
+/*
+ * record_access - Feed accesses to A and B into the cache model
+ */
+static void record_access(char op, unsigned long addr, int size)
+{
+    unsigned long a = (unsigned long)A, b = (unsigned long)B;
+    unsigned long line, last = (addr + size - 1) >> tune_cache.b;
+    if ((addr - a < sizeof(A)) || (addr - b < sizeof(B))) {
+        /* vector accesses may cross into the next line */
+        for (line = addr >> tune_cache.b; line <= last; line++) {
+            if (!probe(&tune_cache, line << tune_cache.b, op == 'S'))
+                fill(&tune_cache, line << tune_cache.b, op == 'S');
+        }
+    }
+}
+
+/*
+ * score - Run one candidate in a cold cache and record its counts.
+ *     Returns 0 if it did not transpose correctly.
+ */
+static int score(struct candidate *c, int s, int E, int b)
+{
+    int M = c->p.M, N = c->p.N;
+    int r, col;
+
+    initMatrix(M, N, A, B);
+    initialCache(&tune_cache, s, E, b, findPolicy("lru"));
+    traceMemStart(record_access);
+    transpose_blocked(M, N, A, B, &c->p);
+    traceMemStop();
+    c->hits = tune_cache.hitCount;
+    c->misses = tune_cache.missCount;
+    c->evictions = tune_cache.evictCount;
+    freeCache(&tune_cache);
+
+    for (r = 0; r < N; r++)
+        for (col = 0; col < M; col++)
+            if (((int (*)[M])A)[r][col] != ((int (*)[N])B)[col][r])
+                return 0;
+    return 1;
+}
+
+/*
+ * compare - Order candidates by misses, then by fewer and squarer tiles
+ */
+static int compare(const void *x, const void *y)
+{
+    const struct candidate *a = x, *b = y;
+    if (a->misses != b->misses)
+        return a->misses - b->misses;
+    if (a->p.tile_rows * a->p.tile_cols != b->p.tile_rows * b->p.tile_cols)
+        return b->p.tile_rows * b->p.tile_cols - a->p.tile_rows * a->p.tile_cols;
+    return abs(a->p.tile_rows - a->p.tile_cols) - abs(b->p.tile_rows - b->p.tile_cols);
+}
+
+/*
+ * tune - Score every candidate for an M x N transpose and return the best
+ */
+static struct trans_params tune(int M, int N, int s, int E, int b, int max_tile)
+{
+    int rows, cols, order, diag, count = 0, i;
+    int max_rows = N < max_tile ? N : max_tile;
+    int max_cols = M < max_tile ? M : max_tile;
+    struct candidate *all = malloc(sizeof(struct candidate) * max_rows * max_cols * 2 * 3);
+    struct trans_params best;
+
+    if (!all) {
+        printf("Error: Cann't allocate the candidate list\n");
+        exit(-1);
+    }
+    for (rows = 1; rows <= max_rows; rows++)
+        for (cols = 1; cols <= max_cols; cols++)
+            for (order = 0; order < 2; order++)
+                for (diag = DIAG_NONE; diag <= DIAG_LOCALS; diag++) {
+                    struct candidate *c = &all[count];
+                    c->p.M = M;
+                    c->p.N = N;
+                    c->p.tile_rows = rows;
+                    c->p.tile_cols = cols;
+                    c->p.order = order;
+                    c->p.diag = diag;
+                    if (!score(c, s, E, b)) {
+                        printf("Error: %dx%d tiles (order %d, diag %s) gave a wrong transpose\n",
+                               rows, cols, order, diag_names[diag]);
+                        exit(-1);
+                    }
+                    count++;
+                }
+    qsort(all, count, sizeof(struct candidate), compare);
+
+    printf("%dx%d: %d candidates (s=%d, E=%d, b=%d)\n", M, N, count, s, E, b);
+    for (i = 0; i < count && i < SHOW_BEST; i++)
+        printf("  tiles:%dx%d order:%s diag:%s hits:%d misses:%d evictions:%d\n",
+               all[i].p.tile_rows, all[i].p.tile_cols,
+               all[i].p.order ? "cols" : "rows", diag_names[all[i].p.diag],
+               all[i].hits, all[i].misses, all[i].evictions);
+    best = all[0].p;
+    free(all);
+    return best;
+}
+
+/*
+ * parseShapes - Parse "32x32,64x64,61x67" into Ms and Ns
+ */
+static int parseShapes(char *str, int *Ms, int *Ns)
+{
+    int count = 0;
+    char *tok;
+    for (tok = strtok(str, ","); tok; tok = strtok(NULL, ",")) {
+        if (count == MAX_SHAPES || sscanf(tok, "%dx%d", &Ms[count], &Ns[count]) != 2
+            || Ms[count] < 1 || Ns[count] < 1 || Ms[count] > MAXN || Ns[count] > MAXN) {
+            printf("Error: Cann't parse shape %s\n", tok);
+            exit(-1);
+        }
+        count++;
+    }
+    return count;
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-S <MxN,...>] [-s <s>] [-E <E>] [-b <b>] [-T <max>] [-o <file>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -S <shapes> Comma-separated MxN shapes to tune (default 32x32,64x64,61x67).\n");
+    printf("  -s <s>      Number of set index bits (default 5).\n");
+    printf("  -E <E>      Associativity (default 1).\n");
+    printf("  -b <b>      Number of block bits (default 5).\n");
+    printf("  -T <max>    Largest tile side to try (default and limit %d).\n", TRANS_MAX_TILE);
+    printf("  -o <file>   Write the best parameters as a trans-tuned.h table.\n");
+    printf("Example: %s -S 61x67 -s 5 -E 1 -b 5 -o trans-tuned.h\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    char c;
+    char shapeArg[256] = "32x32,64x64,61x67", shapeList[256];
+    char *out = NULL;
+    int Ms[MAX_SHAPES], Ns[MAX_SHAPES];
+    struct trans_params best[MAX_SHAPES];
+    int s = 5, E = 1, b = 5, max_tile = TRANS_MAX_TILE;
+    int count, i;
+    FILE *fp;
+
+    while ((c = getopt(argc, argv, "hS:s:E:b:T:o:")) != -1) {
+        switch (c) {
+        case 'S':
+            strncpy(shapeArg, optarg, sizeof(shapeArg) - 1);
+            break;
+        case 's':
+            s = atoi(optarg);
+            break;
+        case 'E':
+            E = atoi(optarg);
+            break;
+        case 'b':
+            b = atoi(optarg);
+            break;
+        case 'T':
+            max_tile = atoi(optarg);
+            break;
+        case 'o':
+            out = optarg;
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (s < 0 || E < 1 || b < 2 || max_tile < 1 || max_tile > TRANS_MAX_TILE) {
+        printf("Error: Invalid cache or tile parameters\n");
+        usage(argv);
+        exit(1);
+    }
+    strcpy(shapeList, shapeArg);
+    count = parseShapes(shapeList, Ms, Ns);
+
+    for (i = 0; i < count; i++)
+        best[i] = tune(Ms[i], Ns[i], s, E, b, max_tile);
+
+    if (out) {
+        fp = fopen(out, "w");
+        if (!fp) {
+            printf("Error: Cann't open %s\n", out);
+            exit(-1);
+        }
+        fprintf(fp, "/*\n * trans-tuned.h - Blocked transpose parameters picked by autotune for\n");
+        fprintf(fp, " *     s=%d, E=%d, b=%d. Regenerate with\n", s, E, b);
+        fprintf(fp, " *     ./autotune -S %s -s %d -E %d -b %d -o %s\n */\n\n", shapeArg, s, E, b, out);
+        fprintf(fp, "#include \"trans-params.h\"\n\n");
+        fprintf(fp, "/* {M, N, tile_rows, tile_cols, order, diag} */\n");
+        fprintf(fp, "static const struct trans_params tuned_params[] = {\n");
+        for (i = 0; i < count; i++)
+            fprintf(fp, "    {%d, %d, %d, %d, %d, %s},\n", best[i].M, best[i].N,
+                    best[i].tile_rows, best[i].tile_cols, best[i].order,
+                    best[i].diag == DIAG_NONE ? "DIAG_NONE" :
+                    best[i].diag == DIAG_DEFER ? "DIAG_DEFER" : "DIAG_LOCALS");
+        fprintf(fp, "};\n");
+        fclose(fp);
+        printf("Wrote %s\n", out);
+    }
+    return 0;
+}
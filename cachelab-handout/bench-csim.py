@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+#
+# bench-csim.py - Measures csim's throughput on synthetic traces. Each
+#     gentrace pattern is generated once as text and once as a binary
+#     trace, csim is run on both, and the best of several runs is
+#     reported as accesses per second. The simulated counts are printed
+#     too, so a throughput change can be told apart from a behaviour
+#     change.
+#
+import subprocess;
+import os;
+import sys;
+import time;
+import shutil;
+import tempfile;
+import optparse;
+
+# Patterns and the gentrace options that give them their character
+PATTERNS = [
+    ("stride",    ["-w", "4194304", "-S", "64"]),
+    ("random",    ["-w", "4194304"]),
+    ("chase",     ["-w", "4194304"]),
+    ("stencil",   ["-n", "512"]),
+    ("gemm",      ["-n", "256", "-t", "16"]),
+    ("transpose", ["-n", "1024", "-t", "8"]),
+    ("sweep",     ["-w", "4194304", "-r", "2"]),
+]
+
+#
+# runCsim - Run csim on a trace and return (seconds, summary line)
+#
+def runCsim(csim, geometry, path):
+    start = time.time()
+    out = subprocess.check_output([csim] + geometry + ["-t", path])
+    elapsed = time.time() - start
+    return elapsed, out.decode().splitlines()[0]
+
+#
+# main - Main function
+#
+def main():
+    parser = optparse.OptionParser()
+    parser.add_option("-c", action="store", dest="count", default="2000000",
+                      help="Accesses per pattern")
+    parser.add_option("-g", action="store", dest="geometry", default="-s 8 -E 8 -b 6",
+                      help="csim geometry options")
+    parser.add_option("-k", action="store", type="int", dest="runs", default=3,
+                      help="Report the best of this many runs")
+    parser.add_option("-p", action="store", dest="patterns", default=None,
+                      help="Comma-separated patterns to run (default all)")
+    (opts, args) = parser.parse_args()
+
+    for tool in ["./csim", "./gentrace"]:
+        if not os.path.exists(tool):
+            print("Error: %s not found, run make first" % tool)
+            sys.exit(1)
+
+    wanted = opts.patterns.split(",") if opts.patterns else None
+    geometry = opts.geometry.split()
+    tmpdir = tempfile.mkdtemp(prefix="bench-csim.")
+    try:
+        print("%-10s %10s %14s %14s  %s" % ("pattern", "accesses", "text acc/s",
+                                            "binary acc/s", "csim summary"))
+        for name, args in PATTERNS:
+            if wanted and name not in wanted:
+                continue
+            text = os.path.join(tmpdir, name + ".trace")
+            binary = os.path.join(tmpdir, name + ".bin")
+            subprocess.check_call(["./gentrace", "-p", name, "-c", opts.count,
+                                   "-o", text, "-B", binary] + args)
+            best = {}
+            for kind, path in [("text", text), ("binary", binary)]:
+                for i in range(opts.runs):
+                    elapsed, summary = runCsim("./csim", geometry, path)
+                    if kind not in best or elapsed < best[kind]:
+                        best[kind] = elapsed
+            count = float(opts.count)
+            print("%-10s %10s %14.0f %14.0f  %s" % (name, opts.count,
+                  count / best["text"], count / best["binary"], summary))
+    finally:
+        shutil.rmtree(tmpdir)
+
+# execute main only if called as a script
+if __name__ == "__main__":
+    main()
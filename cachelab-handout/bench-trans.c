@@ -0,0 +1,267 @@
+/*
+ * bench-trans.c - Benchmarks the registered transpose functions on the
+ *     real machine and lines the results up with the simulated misses.
+ *
+ * trans.c is linked in compiled with -O2. Each function is timed in CPU
+ * cycles with fcyc's K-best scheme, once with a warm cache and once
+ * with the cache flushed before every sample, over a list of matrix
+ * sizes. The simulated misses come from test-trans -i, for the sizes it
+ * accepts. Every measurement is a CSV row:
+ *
+ *   func,description,M,N,cache,cycles,cycles_per_element,bytes_per_cycle,ns,misses,correct
+ *
+ * Besides the functions trans.c registers, bench-trans times the
+ * in-place cycle-following transpose of gentrans.c, which is not a
+ * graded kernel: it copies A into B and transposes B in place, so its
+ * row measures the copy plus the in-place pass, and it has no simulated
+ * misses.
+ *
+ * bytes_per_cycle counts the bytes read from A plus those written to B,
+ * and misses is empty for sizes above test-trans's limit. B is checked
+ * against A after the timed runs of each function: correct is 0 when it
+ * is not A's transpose (transpose_submit only handles the graded sizes,
+ * for instance), and the timings of such a row mean nothing.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "gentrans.h"
+#include "fcyc.h"
+#include "clock.h"
+
+/* External variables defined in cachelab.c */
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+
+/* External function from trans.c */
+extern void registerFunctions();
+
+/* Largest matrix side test-trans can simulate */
+#define SIM_MAXN 256
+
+/* Maximum number of sizes in a sweep */
+#define MAX_SIZES 32
+
+/* Default K and size of the buffer read to flush the cache */
+#define DEFAULT_K 3
+#define DEFAULT_FLUSH (32 << 20)
+
+/* One timed call: fcyc passes this to run_one */
+struct bench_arg {
+    trans_func_t *func;
+    int M, N;
+    int *A, *B;
+};
+
+/*
+ * run_one - The test function handed to fcyc
+ */
+static void run_one(void *p)
+{
+    struct bench_arg *arg = p;
+    int M = arg->M, N = arg->N;
+    (*arg->func->func_ptr)(M, N, (int (*)[M])arg->A, (int (*)[N])arg->B);
+}
+
+/* 
+ * transpose_inplace - Copy A into B unchanged, then transpose B in place
+ *     by cycle following (transposeInPlace in gentrans.c). The copy is
+ *     there because the driver checks B against A; the in-place
+ *     transpose itself needs no second matrix.
+ */
+static char transpose_inplace_desc[] = "Copy then in-place cycle-following transpose";
+static void transpose_inplace(int M, int N, int A[N][M], int B[M][N])
+{
+    int i, j;
+
+    for (i = 0; i < N; i++)
+        for (j = 0; j < M; j++)
+            ((int *)B)[i * M + j] = A[i][j];
+    transposeInPlace(B, N, M, sizeof(int));
+}
+
+/*
+ * is_transpose - Whether B (M rows of N) is the transpose of A (N rows of M)
+ */
+static int is_transpose(int M, int N, int A[N][M], int B[M][N])
+{
+    int i, j;
+    for (i = 0; i < N; i++)
+        for (j = 0; j < M; j++)
+            if (A[i][j] != B[j][i])
+                return 0;
+    return 1;
+}
+
+/*
+ * simulate - Fill misses[] with each function's simulated misses for an
+ *     M x N matrix by running test-trans -i, or -1 where there is none
+ */
+static void simulate(int M, int N, int *misses)
+{
+    char cmd[255], buf[1000], desc[256];
+    unsigned int id, hits, miss, evictions;
+    FILE *fp;
+    int i;
+
+    for (i = 0; i < func_counter; i++)
+        misses[i] = -1;
+    if (M > SIM_MAXN || N > SIM_MAXN)
+        return;
+
+    sprintf(cmd, "./test-trans -i -M %d -N %d", M, N);
+    fp = popen(cmd, "r");
+    if (!fp) {
+        printf("Error: Cann't run %s\n", cmd);
+        exit(-1);
+    }
+    while (fgets(buf, sizeof(buf), fp)) {
+        if (sscanf(buf, "func %u (%255[^)]): hits:%u, misses:%u, evictions:%u",
+                   &id, desc, &hits, &miss, &evictions) != 5)
+            continue;
+        /* test-trans registers the same functions in the same order */
+        for (i = 0; i < func_counter; i++)
+            if (strcmp(func_list[i].description, desc) == 0)
+                misses[i] = miss;
+    }
+    pclose(fp);
+}
+
+/*
+ * bench - Time every function on an M x N matrix and print its rows
+ */
+static void bench(int M, int N, double MHz)
+{
+    int misses[MAX_TRANS_FUNCS];
+    struct bench_arg arg;
+    double cycles, elements = (double)M * N;
+    double timed[2];
+    int i, cold, correct;
+
+    simulate(M, N, misses);
+    arg.M = M;
+    arg.N = N;
+    arg.A = malloc(sizeof(int) * (size_t)M * N);
+    arg.B = malloc(sizeof(int) * (size_t)M * N);
+    if (!arg.A || !arg.B) {
+        printf("Error: Cann't allocate %dx%d matrices\n", M, N);
+        exit(-1);
+    }
+
+    for (i = 0; i < func_counter; i++) {
+        /* fresh B, so B left over by the previous function cannot pass */
+        initMatrix(M, N, (int (*)[M])arg.A, (int (*)[N])arg.B);
+        arg.func = &func_list[i];
+        for (cold = 0; cold < 2; cold++) {
+            set_fcyc_clear_cache(cold);
+            timed[cold] = fcyc(run_one, &arg);
+        }
+        correct = is_transpose(M, N, (int (*)[M])arg.A, (int (*)[N])arg.B);
+        for (cold = 0; cold < 2; cold++) {
+            cycles = timed[cold];
+            printf("%d,\"%s\",%d,%d,%s,%.0f,%.3f,%.3f,%.0f,", i,
+                   func_list[i].description, M, N, cold ? "cold" : "warm",
+                   cycles, cycles / elements,
+                   2.0 * sizeof(int) * elements / cycles, cycles * 1e3 / MHz);
+            if (misses[i] >= 0)
+                printf("%d", misses[i]);
+            printf(",%d\n", correct);
+        }
+    }
+    free(arg.A);
+    free(arg.B);
+}
+
+/*
+ * parseSizes - Parse "32x32,64x64,61x67" into Ms and Ns
+ */
+static int parseSizes(char *str, int *Ms, int *Ns)
+{
+    int count = 0;
+    char *tok;
+    for (tok = strtok(str, ","); tok; tok = strtok(NULL, ",")) {
+        if (count == MAX_SIZES || sscanf(tok, "%dx%d", &Ms[count], &Ns[count]) != 2
+            || Ms[count] < 1 || Ns[count] < 1) {
+            printf("Error: Cann't parse size %s\n", tok);
+            exit(-1);
+        }
+        count++;
+    }
+    return count;
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-M <cols> -N <rows> | -S <MxN,...>] [-k <K>] [-C <bytes>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -M <cols>  Number of matrix columns.\n");
+    printf("  -N <rows>  Number of matrix rows.\n");
+    printf("  -S <sizes> Comma-separated MxN sizes to sweep\n");
+    printf("             (default 32x32,64x64,61x67,128x128,256x256,512x512,1024x1024).\n");
+    printf("  -k <K>     K in the K-best timing scheme (default %d).\n", DEFAULT_K);
+    printf("  -C <bytes> Bytes read to flush the cache for cold runs (default %d).\n", DEFAULT_FLUSH);
+    printf("Example: %s -S 64x64,1024x1024 > bench.csv\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    char c;
+    char sizes[512] = "32x32,64x64,61x67,128x128,256x256,512x512,1024x1024";
+    int M = 0, N = 0, k = DEFAULT_K, flush = DEFAULT_FLUSH;
+    int Ms[MAX_SIZES], Ns[MAX_SIZES];
+    int count, i;
+    double MHz;
+
+    while ((c = getopt(argc, argv, "hM:N:S:k:C:")) != -1) {
+        switch (c) {
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 'S':
+            strncpy(sizes, optarg, sizeof(sizes) - 1);
+            break;
+        case 'k':
+            k = atoi(optarg);
+            break;
+        case 'C':
+            flush = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if ((M != 0) != (N != 0) || M < 0 || N < 0 || k < 1 || flush < 1) {
+        printf("Error: Invalid argument\n");
+        usage(argv);
+        exit(1);
+    }
+    if (M)
+        sprintf(sizes, "%dx%d", M, N);
+    count = parseSizes(sizes, Ms, Ns);
+
+    set_fcyc_k(k);
+    set_fcyc_cache_size(flush);
+    set_fcyc_cache_block(64);
+    MHz = mhz(0);
+
+    registerFunctions();
+    registerTransFunction(transpose_inplace, transpose_inplace_desc);
+    printf("func,description,M,N,cache,cycles,cycles_per_element,bytes_per_cycle,ns,misses,correct\n");
+    for (i = 0; i < count; i++)
+        bench(Ms[i], Ns[i], MHz);
+    return 0;
+}
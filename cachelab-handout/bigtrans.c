@@ -0,0 +1,138 @@
+/*
+ * bigtrans.c - Measures the multithreaded tiled transpose in partrans.c
+ *     on heap-allocated matrices of any size, for 1 up to -t threads.
+ *
+ * For each thread count the matrices are allocated afresh and first
+ * touched by that pool, the transpose is timed as the best of -k runs
+ * and checked, and the bandwidth (bytes read plus bytes written per
+ * second) and the speedup over one thread are printed.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include "partrans.h"
+
+/* Number of timed runs, the fastest of which is reported */
+#define DEFAULT_RUNS 5
+
+/*
+ * now - Current time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * check - Return 1 if B is the transpose of the pattern parFirstTouch
+ *     wrote into A
+ */
+static int check(int M, int N, const int *B)
+{
+    size_t i, j;
+    for (i = 0; i < (size_t)N; i++)
+        for (j = 0; j < (size_t)M; j++)
+            if (B[j * N + i] != (int)(i * M + j))
+                return 0;
+    return 1;
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] -M <cols> -N <rows> [-t <threads>] [-k <runs>] [-b <tile>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h           Print this help message.\n");
+    printf("  -M <cols>    Number of matrix columns.\n");
+    printf("  -N <rows>    Number of matrix rows.\n");
+    printf("  -t <threads> Measure 1 to this many threads (default: online CPUs).\n");
+    printf("  -k <runs>    Report the best of this many runs (default %d).\n", DEFAULT_RUNS);
+    printf("  -b <tile>    Tile side in elements (default %d).\n", PAR_TILE);
+    printf("Example: %s -M 8192 -N 8192 -t 8\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    char c;
+    int M = 0, N = 0, runs = DEFAULT_RUNS, tile = PAR_TILE;
+    int maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int threads, k;
+    int *A, *B;
+    struct pool *pool;
+    double start, elapsed, best, base = 0, bytes;
+
+    while ((c = getopt(argc, argv, "hM:N:t:k:b:")) != -1) {
+        switch (c) {
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 't':
+            maxThreads = atoi(optarg);
+            break;
+        case 'k':
+            runs = atoi(optarg);
+            break;
+        case 'b':
+            tile = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (M < 1 || N < 1 || maxThreads < 1 || runs < 1 || tile < 1) {
+        printf("Error: Missing or invalid required argument\n");
+        usage(argv);
+        exit(1);
+    }
+
+    bytes = 2.0 * sizeof(int) * M * N;
+    printf("%dx%d ints, %.1f MB per matrix, %dx%d tiles\n",
+           M, N, sizeof(int) * (double)M * N / 1e6, tile, tile);
+    for (threads = 1; threads <= maxThreads; threads++) {
+        /* fresh pages, so this pool's threads are the first to touch them */
+        A = malloc(sizeof(int) * (size_t)M * N);
+        B = malloc(sizeof(int) * (size_t)M * N);
+        if (!A || !B) {
+            printf("Error: Cann't allocate %dx%d matrices\n", M, N);
+            exit(-1);
+        }
+        pool = poolCreate(threads);
+        parFirstTouch(pool, M, N, A, B, tile);
+
+        best = 0;
+        for (k = 0; k < runs; k++) {
+            start = now();
+            parTranspose(pool, M, N, A, B, tile);
+            elapsed = now() - start;
+            if (k == 0 || elapsed < best)
+                best = elapsed;
+        }
+        if (!check(M, N, B)) {
+            printf("Error: Wrong transpose with %d threads\n", threads);
+            exit(-1);
+        }
+        if (threads == 1)
+            base = best;
+        printf("threads:%d time:%.3f ms GB/s:%.2f speedup:%.2f\n",
+               threads, best * 1e3, bytes / best / 1e9, base / best);
+
+        poolDestroy(pool);
+        free(A);
+        free(B);
+    }
+    return 0;
+}
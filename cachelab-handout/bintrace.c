@@ -0,0 +1,125 @@
+/*
+ * bintrace.c - Reading and writing the binary trace format
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bintrace.h"
+
+/* 
+ * binTraceOpen - Map the trace at path. Returns 0 on success, 1 if the
+ *     file is not a binary trace, and -1 if it cannot be read.
+ */
+int binTraceOpen(struct binTrace *bt, const char *path)
+{
+    char magic[BINTRACE_MAGIC_LEN];
+    struct stat st;
+
+    /* check the magic with a plain read, text traces are never mapped */
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+    if (fread(magic, 1, BINTRACE_MAGIC_LEN, fp) != BINTRACE_MAGIC_LEN ||
+        memcmp(magic, BINTRACE_MAGIC, BINTRACE_MAGIC_LEN) != 0) {
+        fclose(fp);
+        return 1;
+    }
+    if (fstat(fileno(fp), &st) < 0) {
+        fclose(fp);
+        return -1;
+    }
+    if (st.st_size < BINTRACE_HEADER_LEN) {
+        fclose(fp);
+        return 1;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    fclose(fp);
+    if (base == MAP_FAILED)
+        return -1;
+    posix_madvise(base, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    bt->base = base;
+    bt->length = st.st_size;
+    bt->cur = bt->base + BINTRACE_HEADER_LEN;
+    bt->end = bt->base + bt->length;
+    bt->lastAddr = 0;
+    bt->count = 0;
+    for (int i = 0; i < 8; i++)
+        bt->count |= (unsigned long long)bt->base[BINTRACE_MAGIC_LEN + i] << (8 * i);
+    return 0;
+}
+
+/* binTraceClose - Unmap a trace opened by binTraceOpen */
+void binTraceClose(struct binTrace *bt)
+{
+    munmap(bt->base, bt->length);
+    bt->base = NULL;
+}
+
+/* write the little endian record count after the magic */
+static void writeCount(FILE *fp, unsigned long long count)
+{
+    unsigned char buf[8];
+    for (int i = 0; i < 8; i++)
+        buf[i] = (unsigned char)(count >> (8 * i));
+    fwrite(buf, 1, 8, fp);
+}
+
+static void writeVarint(FILE *fp, unsigned long long v)
+{
+    while (v >= 0x80) {
+        putc((int)((v & 0x7f) | 0x80), fp);
+        v >>= 7;
+    }
+    putc((int)v, fp);
+}
+
+/* binTraceWriterOpen - Create a binary trace at path. Returns 0 on success */
+int binTraceWriterOpen(struct binTraceWriter *w, const char *path)
+{
+    w->fp = fopen(path, "wb");
+    if (!w->fp)
+        return -1;
+    w->lastAddr = 0;
+    w->count = 0;
+    fwrite(BINTRACE_MAGIC, 1, BINTRACE_MAGIC_LEN, w->fp);
+    writeCount(w->fp, 0);
+    return 0;
+}
+
+/* binTraceWrite - Append one access to the trace */
+void binTraceWrite(struct binTraceWriter *w, char op,
+                   unsigned long long addr, int size)
+{
+    int code = 0;
+    while (code < 3 && binTraceOps[code] != op)
+        code++;
+
+    long long delta = (long long)(addr - w->lastAddr);
+    unsigned long long zigzag = ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63);
+
+    if (size >= 0 && size < BINTRACE_BIG_SIZE) {
+        putc(code | (size << 2), w->fp);
+    } else {
+        putc(code | (BINTRACE_BIG_SIZE << 2), w->fp);
+        writeVarint(w->fp, (unsigned long long)size);
+    }
+    writeVarint(w->fp, zigzag);
+    w->lastAddr = addr;
+    w->count++;
+}
+
+/* binTraceWriterClose - Record the final count and close the trace */
+int binTraceWriterClose(struct binTraceWriter *w)
+{
+    int ok = fseek(w->fp, BINTRACE_MAGIC_LEN, SEEK_SET) == 0;
+    if (ok)
+        writeCount(w->fp, w->count);
+    ok = !ferror(w->fp) && ok;
+    return (fclose(w->fp) == 0 && ok) ? 0 : -1;
+}
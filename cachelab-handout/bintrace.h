@@ -0,0 +1,103 @@
+/*
+ * bintrace.h - Compact binary trace format for the cache simulator
+ *
+ * A binary trace starts with an 8 byte magic string followed by the
+ * number of records as a little endian 64-bit integer. Each record is
+ * one head byte holding the operation in the low 2 bits and the access
+ * size in the upper 6 bits (63 means the size follows as a varint),
+ * then the zigzag varint encoded delta from the previous address.
+ */
+
+#ifndef CACHELAB_BINTRACE_H
+#define CACHELAB_BINTRACE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define BINTRACE_MAGIC "CSIMBIN1"
+#define BINTRACE_MAGIC_LEN 8
+#define BINTRACE_HEADER_LEN 16
+#define BINTRACE_BIG_SIZE 63
+
+/* Operation codes, in the order of the 2-bit op field */
+static const char binTraceOps[4] = {'L', 'S', 'M', 'I'};
+
+/* A binary trace mapped into memory for reading */
+struct binTrace {
+    unsigned char *base;
+    size_t length;
+    const unsigned char *cur;
+    const unsigned char *end;
+    unsigned long long lastAddr;
+    unsigned long long count;
+};
+
+/* A binary trace being written */
+struct binTraceWriter {
+    FILE *fp;
+    unsigned long long lastAddr;
+    unsigned long long count;
+};
+
+/* 
+ * binTraceOpen - Map the trace at path. Returns 0 on success, 1 if the
+ *     file is not a binary trace, and -1 if it cannot be read.
+ */
+int binTraceOpen(struct binTrace *bt, const char *path);
+
+/* binTraceClose - Unmap a trace opened by binTraceOpen */
+void binTraceClose(struct binTrace *bt);
+
+/* binTraceWriterOpen - Create a binary trace at path. Returns 0 on success */
+int binTraceWriterOpen(struct binTraceWriter *w, const char *path);
+
+/* binTraceWrite - Append one access to the trace */
+void binTraceWrite(struct binTraceWriter *w, char op,
+                   unsigned long long addr, int size);
+
+/* binTraceWriterClose - Record the final count and close the trace */
+int binTraceWriterClose(struct binTraceWriter *w);
+
+/* read one varint, returns 0 if the trace is truncated */
+static inline int binTraceVarint(struct binTrace *bt, unsigned long long *v)
+{
+    unsigned long long x = 0;
+    int shift = 0;
+    while (bt->cur < bt->end && shift < 64) {
+        unsigned char c = *bt->cur++;
+        x |= (unsigned long long)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *v = x;
+            return 1;
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+/* 
+ * binTraceNext - Decode the next access. Returns 1 on success and 0
+ *     at the end of the trace.
+ */
+static inline int binTraceNext(struct binTrace *bt, char *op,
+                               unsigned long long *addr, int *size)
+{
+    unsigned long long v;
+    if (bt->cur >= bt->end)
+        return 0;
+    unsigned char head = *bt->cur++;
+    *op = binTraceOps[head & 3];
+    *size = head >> 2;
+    if (*size == BINTRACE_BIG_SIZE) {
+        if (!binTraceVarint(bt, &v))
+            return 0;
+        *size = (int)v;
+    }
+    if (!binTraceVarint(bt, &v))
+        return 0;
+    bt->lastAddr += (v >> 1) ^ (~(v & 1) + 1);
+    *addr = bt->lastAddr;
+    return 1;
+}
+
+#endif /* CACHELAB_BINTRACE_H */
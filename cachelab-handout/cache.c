@@ -0,0 +1,264 @@
+/*
+ * cache.c - The cache model shared by csim's simulation modes
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cache.h"
+
+/*
+ *  Cache is a contiguous array of sets, indexed by set number.
+ *  Each set keeps its lines as packed arrays: tags, replacement
+ *  policy state, valid, dirty and prefetched bitmaps, all carved
+ *  out of tables allocated up front.
+ * 	Tag match compares a whole vector of tags at a time.
+ * 	Fill the first invalid line if no match.
+ *  Ask the replacement policy for a victim if full.
+ * 	Tell the policy about every hit and fill.
+ */
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TAG_LANES 4
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TAG_LANES 2
+#else
+#define TAG_LANES 1
+#endif
+
+#define WORD_BITS (sizeof(unsigned long)*8)
+
+/* cache initialization, all lines are allocated up front */
+void initialCache(struct Cache *cache, int s, int E, int b, const struct Policy *policy) {
+	int numSets = (1 << s);
+	int paddedLines = (E + TAG_LANES - 1) / TAG_LANES * TAG_LANES;
+	int validWords = (E + WORD_BITS - 1) / WORD_BITS;
+	int stateWords = policy->stateWords(E);
+	struct Set *sets = (struct Set*)malloc(numSets * sizeof(struct Set));
+	unsigned long *tags = (unsigned long*)calloc((size_t)numSets * paddedLines, sizeof(unsigned long));
+	unsigned long *state = (unsigned long*)calloc((size_t)numSets * stateWords, sizeof(unsigned long));
+	unsigned long *valid = (unsigned long*)calloc((size_t)numSets * validWords, sizeof(unsigned long));
+	unsigned long *dirty = (unsigned long*)calloc((size_t)numSets * validWords, sizeof(unsigned long));
+	unsigned long *prefetched = (unsigned long*)calloc((size_t)numSets * validWords, sizeof(unsigned long));
+	if(!sets || !tags || !state || !valid || !dirty || !prefetched) {
+		printf("Error: Cann't allocate cache!\n");
+		exit(-1);
+	}
+	for(int i = 0; i < numSets; i++) {
+		sets[i].tags = tags + (size_t)i * paddedLines;
+		sets[i].state = state + (size_t)i * stateWords;
+		sets[i].valid = valid + (size_t)i * validWords;
+		sets[i].dirty = dirty + (size_t)i * validWords;
+		sets[i].prefetched = prefetched + (size_t)i * validWords;
+		policy->init(sets[i].state, E, i);
+	}
+	cache->s = s;
+	cache->E = E;
+	cache->b = b;
+	cache->paddedLines = paddedLines;
+	cache->validWords = validWords;
+	cache->stateWords = stateWords;
+	cache->policy = policy;
+	cache->sets = sets;
+	cache->hitCount = cache->missCount = cache->evictCount = 0;
+	cache->fillCount = cache->writebackCount = cache->writeBytes = 0;
+	cache->prefetchFills = cache->prefetchUseful = cache->prefetchUnused = 0;
+	cache->prefetchEvictions = 0;
+	cache->hitPrefetched = 0;
+	cache->timeStamp = 0;
+}
+
+/* valid bits for the TAG_LANES lines starting at line i */
+static inline unsigned validLanes(struct Set *set, int i) {
+	return (set->valid[i / WORD_BITS] >> (i % WORD_BITS)) & ((1u << TAG_LANES) - 1);
+}
+
+/* return the valid line holding tag, or -1 */
+static inline int matchTag(struct Cache *cache, struct Set *set, unsigned long tag) {
+	int paddedLines = cache->paddedLines;
+#if defined(__AVX2__)
+	__m256i key = _mm256_set1_epi64x((long long)tag);
+	for(int i = 0; i < paddedLines; i += TAG_LANES) {
+		__m256i v = _mm256_loadu_si256((__m256i*)(set->tags + i));
+		unsigned hits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key)));
+		hits &= validLanes(set, i);
+		if(hits) {
+			return i + __builtin_ctz(hits);
+		}
+	}
+#elif defined(__SSE2__)
+	__m128i key = _mm_set1_epi64x((long long)tag);
+	for(int i = 0; i < paddedLines; i += TAG_LANES) {
+		__m128i v = _mm_loadu_si128((__m128i*)(set->tags + i));
+		/* SSE2 has no 64-bit compare, both 32-bit halves must match */
+		__m128i eq = _mm_cmpeq_epi32(v, key);
+		eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+		unsigned hits = _mm_movemask_pd(_mm_castsi128_pd(eq));
+		hits &= validLanes(set, i);
+		if(hits) {
+			return i + __builtin_ctz(hits);
+		}
+	}
+#else
+	for(int i = 0; i < paddedLines; i++) {
+		if(validLanes(set, i) && set->tags[i] == tag) {
+			return i;
+		}
+	}
+#endif
+	return -1;
+}
+
+/* return the first invalid line, or -1 if the set is full */
+static inline int freeLine(struct Cache *cache, struct Set *set) {
+	for(int w = 0; w < cache->validWords; w++) {
+		unsigned long empty = ~set->valid[w];
+		if(empty) {
+			int i = w * WORD_BITS + __builtin_ctzl(empty);
+			return i < cache->E ? i : -1;
+		}
+	}
+	return -1;
+}
+
+static inline void setBit(unsigned long *bits, int i, int v) {
+	if(v) {
+		bits[i / WORD_BITS] |= 1UL << (i % WORD_BITS);
+	}else {
+		bits[i / WORD_BITS] &= ~(1UL << (i % WORD_BITS));
+	}
+}
+
+static inline int testBit(unsigned long *bits, int i) {
+	return (bits[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+/* tag and set index of an address, shifted in two steps so s+b may reach 64 */
+static inline unsigned long tagOf(struct Cache *cache, unsigned long address) {
+	return (address >> cache->b) >> cache->s;
+}
+
+static inline unsigned long setOf(struct Cache *cache, unsigned long address) {
+	return (address >> cache->b) & ((1UL << cache->s) - 1);
+}
+
+/* look an address up, count a hit or a miss, return 1 on a hit */
+int probe(struct Cache *cache, unsigned long address, int write) {
+	unsigned long tag = tagOf(cache, address);
+	unsigned long setNum = setOf(cache, address);
+	struct Set *set = &cache->sets[setNum];
+	unsigned long timeStamp = ++cache->timeStamp;
+
+	int i = matchTag(cache, set, tag);
+	if(i < 0) {
+		cache->missCount++;
+		cache->hitPrefetched = 0;
+		return 0;
+	}
+	cache->hitCount++;
+	cache->policy->touch(set->state, cache->E, i, timeStamp);
+	if(write) {
+		setBit(set->dirty, i, 1);
+	}
+	/* the first demand hit on a prefetched line makes the prefetch useful */
+	cache->hitPrefetched = testBit(set->prefetched, i);
+	if(cache->hitPrefetched) {
+		setBit(set->prefetched, i, 0);
+		cache->prefetchUseful++;
+	}
+	return 1;
+}
+
+/* put tag in set, evicting the policy's victim if the set is full; a
+   prefetch's victim is kept out of the demand eviction count */
+static struct Victim fillLine(struct Cache *cache, struct Set *set, unsigned long setNum,
+	unsigned long tag, int dirty, int prefetched) {
+	struct Victim victim = {0, 0, 0, 0};
+
+	/* fill an empty line, evict the policy's victim if full */
+	int i = freeLine(cache, set);
+	if(i < 0) {
+		i = cache->policy->victim(set->state, cache->E);
+		if(prefetched) {
+			cache->prefetchEvictions++;
+		}else {
+			cache->evictCount++;
+		}
+		victim.valid = 1;
+		victim.dirty = testBit(set->dirty, i);
+		victim.prefetched = testBit(set->prefetched, i);
+		victim.address = ((set->tags[i] << cache->s) | setNum) << cache->b;
+		cache->writebackCount += victim.dirty;
+		cache->prefetchUnused += victim.prefetched;
+	}
+	cache->fillCount++;
+	setBit(set->valid, i, 1);
+	setBit(set->dirty, i, dirty);
+	setBit(set->prefetched, i, prefetched);
+	set->tags[i] = tag;
+	cache->policy->insert(set->state, cache->E, i, ++cache->timeStamp);
+	return victim;
+}
+
+/* bring an address into the cache, return the line it replaced, counting fills and dirty victims */
+struct Victim fill(struct Cache *cache, unsigned long address, int dirty) {
+	unsigned long setNum = setOf(cache, address);
+	return fillLine(cache, &cache->sets[setNum], setNum, tagOf(cache, address), dirty, 0);
+}
+
+/* fill an absent address without a demand access, marked as prefetched, return 1 if filled */
+int prefetchFill(struct Cache *cache, unsigned long address, struct Victim *victim) {
+	unsigned long tag = tagOf(cache, address);
+	unsigned long setNum = setOf(cache, address);
+	struct Set *set = &cache->sets[setNum];
+	if(matchTag(cache, set, tag) >= 0) {
+		return 0;
+	}
+	*victim = fillLine(cache, set, setNum, tag, 0, 1);
+	cache->prefetchFills++;
+	return 1;
+}
+
+/* drop an address, return -1 if absent, otherwise its dirty bit */
+int invalidate(struct Cache *cache, unsigned long address) {
+	unsigned long tag = tagOf(cache, address);
+	unsigned long setNum = setOf(cache, address);
+	struct Set *set = &cache->sets[setNum];
+	int i = matchTag(cache, set, tag);
+	if(i < 0) {
+		return -1;
+	}
+	setBit(set->valid, i, 0);
+	setBit(set->prefetched, i, 0);
+	return testBit(set->dirty, i);
+}
+
+/* mark a present address dirty without counting an access, return 1 if present */
+int markDirty(struct Cache *cache, unsigned long address) {
+	unsigned long tag = tagOf(cache, address);
+	unsigned long setNum = setOf(cache, address);
+	struct Set *set = &cache->sets[setNum];
+	int i = matchTag(cache, set, tag);
+	if(i < 0) {
+		return 0;
+	}
+	setBit(set->dirty, i, 1);
+	return 1;
+}
+
+/* look an address up without counting an access, return 1 if present */
+int contains(struct Cache *cache, unsigned long address) {
+	unsigned long setNum = setOf(cache, address);
+	return matchTag(cache, &cache->sets[setNum], tagOf(cache, address)) >= 0;
+}
+
+/* free the line tables and sets */
+void freeCache(struct Cache *cache) {
+	free(cache->sets[0].tags);
+	free(cache->sets[0].state);
+	free(cache->sets[0].valid);
+	free(cache->sets[0].dirty);
+	free(cache->sets[0].prefetched);
+	free(cache->sets);
+}
@@ -0,0 +1,64 @@
+/*
+ * cache.h - The cache model shared by csim's simulation modes
+ */
+
+#ifndef CACHELAB_CACHE_H
+#define CACHELAB_CACHE_H
+
+#include "policy.h"
+
+struct Set {
+	unsigned long *tags;
+	unsigned long *state;
+	unsigned long *valid;
+	unsigned long *dirty;
+	unsigned long *prefetched;    /* brought in by a prefetch, not used yet */
+};
+
+/* a cache is its geometry, its sets and the counters of one replay */
+struct Cache {
+	int s, E, b;
+	int paddedLines, validWords, stateWords;
+	const struct Policy *policy;
+	struct Set *sets;
+	int hitCount, missCount, evictCount;
+	unsigned long fillCount, writebackCount, writeBytes;
+	unsigned long prefetchFills, prefetchUseful, prefetchUnused;
+	unsigned long prefetchEvictions;  /* lines evicted by prefetch fills, not in evictCount */
+	int hitPrefetched;            /* the last hit was the first use of a prefetch */
+	unsigned long timeStamp;
+};
+
+/* a line pushed out of a cache by a fill */
+struct Victim {
+	int valid;
+	int dirty;
+	int prefetched;               /* a prefetched line evicted before any use */
+	unsigned long address;
+};
+
+/* cache initialization, all lines are allocated up front */
+void initialCache(struct Cache *cache, int s, int E, int b, const struct Policy *policy);
+
+/* free the line tables and sets */
+void freeCache(struct Cache *cache);
+
+/* look an address up, count a hit or a miss, return 1 on a hit */
+int probe(struct Cache *cache, unsigned long address, int write);
+
+/* bring an address into the cache, return the line it replaced, counting fills and dirty victims */
+struct Victim fill(struct Cache *cache, unsigned long address, int dirty);
+
+/* fill an absent address without a demand access, marked as prefetched, return 1 if filled */
+int prefetchFill(struct Cache *cache, unsigned long address, struct Victim *victim);
+
+/* drop an address, return -1 if absent, otherwise its dirty bit */
+int invalidate(struct Cache *cache, unsigned long address);
+
+/* mark a present address dirty without counting an access, return 1 if present */
+int markDirty(struct Cache *cache, unsigned long address);
+
+/* look an address up without counting an access, return 1 if present */
+int contains(struct Cache *cache, unsigned long address);
+
+#endif /* CACHELAB_CACHE_H */
@@ -4,153 +4,261 @@
  */
 
 #include "cachelab.h" 
+#include "bintrace.h"
+#include "sweep.h"
+#include "policy.h"
+#include "cache.h"
+#include "hierarchy.h"
+#include "attrib.h"
+#include "prefetch.h"
 #include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <pthread.h>
 
 const int m = sizeof(long)*8;
-int hitCount = 0, missCount = 0, evictCount = 0;
-int s = 0, b = 0, E = 0, t = 0, vFlag = 0, hFlag = 0;
-char *trace = NULL;
+int s = 0, b = 0, E = 0, t = 0, vFlag = 0, hFlag = 0, jobs = 1;
+int writeAllocate = 1, trafficFlag = 0, splitFlag = 0;
+char *trace = NULL, *attribPath = NULL;
+const struct Policy *policy = NULL;
+
+/* geometry lists, more than one value in any of them sweeps the grid */
+int sList[MAX_SWEEP], EList[MAX_SWEEP], bList[MAX_SWEEP];
+int sNum = 0, ENum = 0, bNum = 0, sweepFlag = 0;
+
+/* fetch an address in the cache, a write dirties the line */
+void fetch(struct Cache *cache, unsigned long address, int write, int size){
+	/* hit and return if tag matches */
+	if(probe(cache, address, write)) {
+		if(vFlag) {
+			printf("hit ");
+		}
+		if(prefetchFlag) {
+			prefetchAccess(cache, address, 1);
+		}
+		return;
+	}
+
+	/* fill an empty line if miss, eviction may happen */
+	if(vFlag) {
+		printf("miss ");
+	}
+
+	/* without write allocate a store miss goes straight to the next level */
+	if(write && !writeAllocate) {
+		cache->writeBytes += size;
+		if(attribFlag) {
+			attribMiss(address, 0);
+		}
+		if(prefetchFlag) {
+			prefetchAccess(cache, address, 0);
+		}
+		return;
+	}
+	struct Victim victim = fill(cache, address, write);
+	if(victim.valid && vFlag) {
+		printf("eviction ");
+	}
+	if(attribFlag) {
+		attribMiss(address, victim.valid);
+	}
+	if(prefetchFlag) {
+		prefetchAccess(cache, address, 0);
+	}
+}
+
+/*
+ *  Parallel replay with -j shards the accesses by set index.
+ *  Sets are independent, so each thread replays the accesses of a
+ *  contiguous range of sets, in trace order, on its own counters.
+ *  The merged counts are identical to a serial replay.
+ *  The shard threads run while the trace is decoded: the decoder
+ *  appends each access to its shard's current chunk and hands full
+ *  chunks over through a short queue, which the shard frees once it
+ *  has replayed them, so memory stays bounded whatever the trace.
+ */
+
+/* accesses per chunk, and full chunks a shard may have queued */
+#define CHUNK_RECORDS (1 << 14)
+#define CHUNK_QUEUE 16
 
 /*
- *  Cache is considered as a linked list of sets.
- *  Set is a linked list of Lines, with number of valid lines.
- *  Line has a flag, a tag and a pointer to the next line.
- * 	Add new line if no match.
- *  Evict the earliest line at the end if full.
- * 	Move matched line to the head as the latest added line.
+ *  An access is packed in one word: the block address, size-1 in the
+ *  block offset bits (a record never crosses a block, so it fits) and
+ *  the write flag in the top bit.
  */
+#define RECORD_WRITE (1UL << (sizeof(long)*8 - 1))
 
-struct Line {
-	int validFlag;
-	unsigned tag;
-	struct Line *nextLine;
+struct Chunk {
+	unsigned long record[CHUNK_RECORDS];
+	size_t num;
+	struct Chunk *next;
 };
 
-struct Set {
-	int maxLines;
-	int numLines;
-	struct Line *headLine;
-	struct Set *nextSet;
+struct Shard {
+	struct Cache cache;
+	struct Chunk *fill;           /* being filled by the decoder */
+	struct Chunk *head, *tail;    /* full chunks waiting to be replayed */
+	int queued, done;
+	pthread_mutex_t lock;
+	pthread_cond_t ready, space;
+	pthread_t tid;
 };
 
-/* setList initialization, return setList pointer*/
-struct Set* initialSetList(int E, int s) {
-    int numSets = (1 << s);
-    struct Set *headSet;
-    struct Set *set = (struct Set*)malloc(sizeof(struct Set));
-    headSet = set;
-  	set->maxLines = E;
-  	set->numLines = 0;
-  	set->headLine = NULL;
-  	set->nextSet = NULL;
-    for(int i = 1; i < numSets; i++) {
-    	struct Set *nextSet = (struct Set*)malloc(sizeof(struct Set));
-		nextSet->maxLines = E;
-  		nextSet->numLines = 0;
-  		nextSet->headLine = NULL;
-  		nextSet->nextSet = NULL;
-  		set->nextSet = nextSet;
-  		set = nextSet;
-    }	
-    return headSet;
+struct Shard *shardList = NULL;
+int shardNum = 0;
+
+/* shard owning the set of an address */
+static inline int shardOf(struct Cache *cache, int shards, unsigned long address) {
+	unsigned long setNum = ((1UL << cache->s)-1)&(address >> cache->b);
+	return (int)((setNum * shards) >> cache->s);
 }
 
-/* delete the last line */
-void deleteLine(struct Set *set) {
-	struct Line *current = set->headLine;
-	struct Line *previous = NULL;
-	if(current != NULL) {
-		while(current->nextLine != NULL) {
-			previous = current;
-			current = current->nextLine;
-		}
-		if(previous == NULL) {
-			set->headLine = NULL;
-		}else {
-			previous->nextLine = NULL;
-		}
-		set->numLines--;
-		free(current);
+/* queue a chunk for its shard, waiting while the queue is full */
+void publish(struct Shard *shard, struct Chunk *chunk) {
+	pthread_mutex_lock(&shard->lock);
+	while(shard->queued == CHUNK_QUEUE) {
+		pthread_cond_wait(&shard->space, &shard->lock);
 	}
+	chunk->next = NULL;
+	if(shard->tail) {
+		shard->tail->next = chunk;
+	}else {
+		shard->head = chunk;
+	}
+	shard->tail = chunk;
+	shard->queued++;
+	pthread_cond_signal(&shard->ready);
+	pthread_mutex_unlock(&shard->lock);
 }
 
-/* add line to the head of a set, may evict if full */
-void addLine(struct Set *set, struct Line *line) {
-	if(set->maxLines == set->numLines) {
-		deleteLine(set);
-		evictCount++;
-		if(vFlag) {
-			printf("eviction ");
+/* hand an access to the shard owning its set */
+void record(unsigned long address, int write, int size) {
+	struct Shard *shard = &shardList[shardOf(&shardList[0].cache, shardNum, address)];
+	if(address & RECORD_WRITE) {
+		printf("Error: -j needs addresses below 2^%d, got %lx\n", (int)sizeof(long)*8 - 1, address);
+		exit(-1);
+	}
+	if(!shard->fill) {
+		shard->fill = (struct Chunk*)malloc(sizeof(struct Chunk));
+		if(!shard->fill) {
+			printf("Error: Cann't allocate access buffer!\n");
+			exit(-1);
 		}
+		shard->fill->num = 0;
+	}
+	unsigned long blockMask = (1UL << b) - 1;
+	shard->fill->record[shard->fill->num++] = (address & ~blockMask) | (unsigned long)(size - 1) |
+		(write ? RECORD_WRITE : 0);
+	if(shard->fill->num == CHUNK_RECORDS) {
+		publish(shard, shard->fill);
+		shard->fill = NULL;
 	}
-	line->nextLine = set->headLine;
-	set->headLine = line;
-	set->numLines++;
 }
 
-/* fetch an address in the cache */
-void fetch(struct Set *set, unsigned address){
-	int tag = address >> (m-t);
-	int setNum = ((1 << s)-1)&(address >> b);
-
-	/* find the target set */
-	for(int i = 0; i < setNum; i++) {
-		set = set->nextSet;
-	} 
-
-	/* hit and return if tag matches */
-	struct Line *line = set->headLine;
-	struct Line *previous = NULL;
-	while(line != NULL) {
-		if(line->validFlag && (line->tag == tag)) {
-			hitCount++;
-			if(vFlag) {
-				printf("hit ");
-			}
-			if(previous != NULL) {
-				previous->nextLine = line->nextLine;
-				line->nextLine = set->headLine;
-				set->headLine = line;
+void *replayShard(void *arg) {
+	struct Shard *shard = (struct Shard*)arg;
+	unsigned long blockMask = (1UL << shard->cache.b) - 1;
+	for(;;) {
+		pthread_mutex_lock(&shard->lock);
+		while(!shard->head && !shard->done) {
+			pthread_cond_wait(&shard->ready, &shard->lock);
+		}
+		struct Chunk *chunk = shard->head;
+		if(chunk) {
+			shard->head = chunk->next;
+			if(!shard->head) {
+				shard->tail = NULL;
 			}
-			return;
+			shard->queued--;
+			pthread_cond_signal(&shard->space);
+		}
+		pthread_mutex_unlock(&shard->lock);
+		if(!chunk) {
+			return NULL;
+		}
+		for(size_t i = 0; i < chunk->num; i++) {
+			unsigned long r = chunk->record[i];
+			fetch(&shard->cache, r & ~RECORD_WRITE & ~blockMask, (r & RECORD_WRITE) != 0,
+				(int)(r & blockMask) + 1);
 		}
-		previous = line;
-		line = line->nextLine;	
+		free(chunk);
 	}
+}
 
-	/* add new line if miss, eviction may happen*/
-	missCount++;
-	if(vFlag) {
-		printf("miss ");
+/* start up to jobs shard threads on copies of cache, before the trace is read */
+void replayStart(struct Cache *cache, int jobs) {
+	shardNum = jobs < (1 << cache->s) ? jobs : (1 << cache->s);
+	shardList = (struct Shard*)calloc(shardNum, sizeof(struct Shard));
+	if(!shardList) {
+		printf("Error: Cann't allocate shards!\n");
+		exit(-1);
+	}
+	for(int k = 0; k < shardNum; k++) {
+		shardList[k].cache = *cache;
+		pthread_mutex_init(&shardList[k].lock, NULL);
+		pthread_cond_init(&shardList[k].ready, NULL);
+		pthread_cond_init(&shardList[k].space, NULL);
+		pthread_create(&shardList[k].tid, NULL, replayShard, &shardList[k]);
 	}
-	struct Line *newLine = (struct Line *)malloc(sizeof(struct Line));
-	newLine->validFlag = 1;
-	newLine->tag = tag;
-	addLine(set,newLine);
 }
 
-/* free all lines and sets */
-void freeSetList(struct Set *set) {
-	while(set != NULL) {
-		struct Line *line = set->headLine;
-		while(line != NULL) {
-			struct Line *tempLine = line->nextLine;
-			free(line);
-			line = tempLine;
+/* hand over the last accesses, wait for the shards and merge their counts */
+void replayFinish(struct Cache *cache) {
+	for(int k = 0; k < shardNum; k++) {
+		struct Shard *shard = &shardList[k];
+		if(shard->fill) {
+			publish(shard, shard->fill);
+			shard->fill = NULL;
 		}
-		struct Set *tempSet = set->nextSet;
-		free(set);
-		set = tempSet;
+		pthread_mutex_lock(&shard->lock);
+		shard->done = 1;
+		pthread_cond_signal(&shard->ready);
+		pthread_mutex_unlock(&shard->lock);
 	}
+	for(int k = 0; k < shardNum; k++) {
+		struct Shard *shard = &shardList[k];
+		pthread_join(shard->tid, NULL);
+		cache->hitCount += shard->cache.hitCount;
+		cache->missCount += shard->cache.missCount;
+		cache->evictCount += shard->cache.evictCount;
+		cache->fillCount += shard->cache.fillCount;
+		cache->writebackCount += shard->cache.writebackCount;
+		cache->writeBytes += shard->cache.writeBytes;
+		pthread_mutex_destroy(&shard->lock);
+		pthread_cond_destroy(&shard->ready);
+		pthread_cond_destroy(&shard->space);
+	}
+	free(shardList);
+	shardList = NULL;
+}
+
+/* parse a list like "1,3-5" into values, return the number of values */
+int parseList(char *arg, int *list) {
+	int num = 0;
+	char *p = arg;
+	while(*p && num < MAX_SWEEP) {
+		int lo = strtol(p, &p, 10), hi = lo;
+		if(*p == '-') {
+			hi = strtol(p + 1, &p, 10);
+		}
+		for(int v = lo; v <= hi && num < MAX_SWEEP; v++) {
+			list[num++] = v;
+		}
+		if(*p != ',') {
+			break;
+		}
+		p++;
+	}
+	return num;
 }
 
 /* set the parameters */
 void setPara(int argc, char** argv) {
 	int opt;
-	while(-1 != (opt = getopt(argc, argv, "vhs:E:b:t:"))) {
+	while(-1 != (opt = getopt(argc, argv, "vhcs:E:b:t:j:r:L:w:A:R:P:"))) {
 		switch(opt) {
 			case 'v':
 				vFlag = 1;
@@ -158,65 +266,237 @@ void setPara(int argc, char** argv) {
 			case 'h':
 				hFlag = 1;
 				break;
+			case 'c':
+				splitFlag = 1;
+				break;
 			case 's':
-				s = atoi(optarg);
+				sNum = parseList(optarg, sList);
 				break;
 			case 'E':
-				E = atoi(optarg);
+				ENum = parseList(optarg, EList);
 				break;
 			case 'b':
-				b = atoi(optarg);
+				bNum = parseList(optarg, bList);
 				break;
 			case 't':
 				trace = optarg;
 				break;
+			case 'j':
+				jobs = atoi(optarg);
+				break;
+			case 'r':
+				policy = findPolicy(optarg);
+				if(!policy) {
+					printf("Error: Unknown replacement policy %s, use one of %s\n", optarg, policyNames);
+					exit(-1);
+				}
+				break;
+			case 'L':
+				hierAddLevel(optarg);
+				break;
+			case 'A':
+				attribPath = optarg;
+				break;
+			case 'R':
+				attribAddRegion(optarg);
+				break;
+			case 'P':
+				prefetchAdd(optarg);
+				break;
+			case 'w':
+				trafficFlag = 1;
+				if(strcmp(optarg, "allocate") == 0) {
+					writeAllocate = 1;
+				}else if(strcmp(optarg, "noallocate") == 0) {
+					writeAllocate = 0;
+				}else {
+					printf("Error: Unknown write policy %s, use allocate or noallocate\n", optarg);
+					exit(-1);
+				}
+				break;
 			default:
 				break;
 		}
 	}
+	sweepFlag = sNum > 1 || ENum > 1 || bNum > 1;
+	s = sNum ? sList[0] : 0;
+	E = ENum ? EList[0] : 0;
+	b = bNum ? bList[0] : 0;
 	t = m - s - b;
+
+	/* LRU unless asked otherwise, sweeps rely on LRU inclusion */
+	if(!policy) {
+		policy = findPolicy("lru");
+	}
+	if(sweepFlag && strcmp(policy->name, "lru") != 0) {
+		printf("Error: Sweeping geometries needs the lru policy\n");
+		exit(-1);
+	}
+	if(sweepFlag && !writeAllocate) {
+		printf("Error: Sweeping geometries needs write allocate\n");
+		exit(-1);
+	}
+	if(sweepFlag && attribPath) {
+		printf("Error: Sweeping geometries cannot attribute misses\n");
+		exit(-1);
+	}
+	if(sweepFlag && hierLevels()) {
+		printf("Error: Sweeping geometries simulates a single level\n");
+		exit(-1);
+	}
+	if(prefetchFlag && (sweepFlag || hierLevels())) {
+		printf("Error: Prefetchers are modelled on a single cache, not with sweeps or -L\n");
+		exit(-1);
+	}
+	if(strcmp(policy->name, "plru") == 0 && (E & (E - 1))) {
+		printf("Error: The plru policy needs E to be a power of 2\n");
+		exit(-1);
+	}
+
+	/* verbose output and prefetcher training follow the trace order, so they are never sharded */
+	if(vFlag || sweepFlag || hierLevels() || attribPath || prefetchFlag || jobs < 1) {
+		jobs = 1;
+	}
+}
+
+/* simulate the part of a trace record that falls in one block */
+void simulateBlock(struct Cache *cache, char op, unsigned long addr, int size) {
+	if(jobs > 1) {
+		if((op == 'L')||(op == 'S')) {
+			record(addr, op == 'S', size);
+		}
+		if(op == 'M') {
+			record(addr, 0, size);
+			record(addr, 1, size);
+		}
+		return;
+	}
+	if(hierLevels()) {
+		hierAccess(op, addr, size);
+		return;
+	}
+	if((op == 'L')||(op == 'S')) {
+		fetch(cache, addr, op == 'S', size);
+	}
+	if(op == 'M') {
+		fetch(cache, addr, 0, size);
+		fetch(cache, addr, 1, size);
+	}
+}
+
+/*
+ * simulate one trace record. Like csim-ref, an access probes only the
+ * block of its first byte; with -c an access crossing blocks probes
+ * each block it touches.
+ */
+void simulate(struct Cache *cache, char op, unsigned long addr, int size) {
+	if(sweepFlag) {
+		int bytes = splitFlag ? size : 1;
+		if((op == 'L')||(op == 'S')) {
+			sweepFetch(addr, bytes);
+		}
+		if(op == 'M') {
+			sweepFetch(addr, bytes);
+			sweepFetch(addr, bytes);
+		}
+		return;
+	}
+	if(vFlag) {
+		printf("%c %lx, %d ", op, addr, size);
+	}
+	unsigned long end = addr + (size > 1 ? size - 1 : 0);
+	if(!splitFlag && (addr >> b) != (end >> b)) {
+		end = addr | ((1UL << b) - 1);
+	}
+	while((addr >> b) != (end >> b)) {
+		unsigned long next = ((addr >> b) + 1) << b;
+		simulateBlock(cache, op, addr, next - addr);
+		addr = next;
+	}
+	simulateBlock(cache, op, addr, end - addr + 1);
+	if(vFlag) {
+		printf("\n");
+	}
 }
 
 int main(int argc, char** argv) {	
 	char op;
-	unsigned addr;
+	unsigned long addr;
+	unsigned long long addr64;
 	int size;
+	struct binTrace bt;
 
 	/* initialization */
     setPara(argc, argv);
-	struct Set *set = initialSetList(E, s);
+	struct Cache cache;
+	if(sweepFlag) {
+		sweepInit(sList, sNum, EList, ENum, bList, bNum);
+	}else {
+		initialCache(&cache, s, E, b, policy);
+	}
+	if(hierLevels()) {
+		hierInit(&cache, policy);
+	}
+	if(attribPath) {
+		attribInit(s, b, attribPath);
+	}
+	if(jobs > 1) {
+		replayStart(&cache, jobs);
+	}
 
-	/* read trace file */
-	FILE *traceFile;
-	traceFile = fopen(trace, "r");
-	if(!traceFile) {
+	/* binary traces are mapped and streamed without parsing */
+	int status = binTraceOpen(&bt, trace);
+	if(status < 0) {
 		printf("Error: Cann't open file %s!\n", trace);
 		return -1;
-	} 
-
-	/* access the cache and print the result*/
-	while(fscanf(traceFile, "%c %x, %d", &op, &addr, &size) > 0) {
-		if(vFlag) {
-			printf("%c %x, %d ", op, addr, size);
-		}
-		if((op == 'L')||(op == 'S')) {
-			fetch(set, addr);
-		}
-		if(op == 'M') {
-			fetch(set, addr);
-			fetch(set, addr);
+	}
+	if(status == 0) {
+		while(binTraceNext(&bt, &op, &addr64, &size)) {
+			simulate(&cache, op, (unsigned long)addr64, size);
 		}
-		if(vFlag) {
-			printf("\n");
+		binTraceClose(&bt);
+	}else {
+		/* read text trace file */
+		FILE *traceFile;
+		traceFile = fopen(trace, "r");
+		if(!traceFile) {
+			printf("Error: Cann't open file %s!\n", trace);
+			return -1;
+		} 
+
+		/* access the cache and print the result*/
+		while(fscanf(traceFile, "%c %lx, %d", &op, &addr, &size) > 0) {
+			simulate(&cache, op, addr, size);
 		}
+		fclose(traceFile); 
 	}
 
-	/* reset the cache */
-	fclose(traceFile); 
-	freeSetList(set);
-	printSummary(hitCount, missCount, evictCount);
-	return 0; 
-}
+	/* one summary line per geometry when sweeping */
+	if(sweepFlag) {
+		sweepReport();
+		return 0;
+	}
 
+	if(jobs > 1) {
+		replayFinish(&cache);
+	}
 
+	if(attribFlag) {
+		attribReport();
+	}
 
+	/* reset the cache */
+	freeCache(&cache);
+	printSummary(cache.hitCount, cache.missCount, cache.evictCount);
+	if(hierLevels()) {
+		hierReport();
+	}else if(vFlag || trafficFlag || prefetchFlag) {
+		/* traffic to and from the next level, kept off the stock summary */
+		printf("writebacks:%lu bytes_read:%lu bytes_written:%lu\n", cache.writebackCount,
+			cache.fillCount << b, (cache.writebackCount << b) + cache.writeBytes);
+	}
+	if(prefetchFlag) {
+		prefetchReport(&cache);
+	}
+	return 0; 
+}
@@ -0,0 +1,302 @@
+/*
+ * gentrace.c - Generate synthetic memory traces with known access
+ *     patterns, for stress testing csim and measuring its throughput.
+ *
+ * Usage: ./gentrace -p <pattern> [options]
+ *
+ * Patterns:
+ *   stride     Loads walking a working set of -w bytes with a stride
+ *              of -S bytes, wrapping around
+ *   random     Uniformly random loads and stores (one in four) in -w bytes
+ *   chase      Pointer chasing: loads following a random cycle through
+ *              the 64-byte nodes of -w bytes, so no two are adjacent
+ *   stencil    5-point stencil over an -n x -n grid of doubles, B = f(A)
+ *   gemm       Blocked C += A * B on -n x -n doubles with -t x -t tiles
+ *   transpose  Blocked B = A^T on -n x -n ints with -t x -t tiles
+ *   sweep      Sequential line-by-line passes over working sets doubling
+ *              from 1KB to -w bytes, each pass made -r times
+ *
+ * Each pattern repeats until -c accesses have been produced. The trace
+ * is written as text in the lackey format csim reads (-o, or stdout)
+ * and/or in the binary format of bintrace.h (-B).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "bintrace.h"
+
+/* Where the matrices of the structured patterns start */
+#define BASE_A 0x10000000ULL
+#define BASE_B 0x20000000ULL
+#define BASE_C 0x30000000ULL
+
+/* Node size of the pointer chase */
+#define NODE 64
+
+/* Options */
+static unsigned long long workingSet = 1 << 20;
+static unsigned long long stride = 64;
+static int dim = 256;
+static int tile = 8;
+static int repeat = 4;
+
+/* Where accesses go and how many are still wanted */
+static FILE *textFp;
+static struct binTraceWriter binWriter;
+static int binOpen;
+static unsigned long long remaining = 1000000;
+static unsigned long long seed = 1;
+
+/*
+ * emit - Write one access. Returns 0 once enough have been written.
+ */
+static int emit(char op, unsigned long long addr, int size)
+{
+    if (remaining == 0)
+        return 0;
+    if (textFp)
+        fprintf(textFp, " %c %llx,%d\n", op, addr, size);
+    if (binOpen)
+        binTraceWrite(&binWriter, op, addr, size);
+    return --remaining > 0;
+}
+
+/*
+ * rnd - xorshift64 random numbers, reproducible from the seed
+ */
+static unsigned long long rnd(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+static void genStride(void)
+{
+    unsigned long long off;
+    for (;;)
+        for (off = 0; off < workingSet; off += stride)
+            if (!emit('L', BASE_A + off, 8))
+                return;
+}
+
+static void genRandom(void)
+{
+    unsigned long long off;
+    for (;;) {
+        off = rnd() % (workingSet / 8) * 8;
+        if (!emit(rnd() % 4 == 0 ? 'S' : 'L', BASE_A + off, 8))
+            return;
+    }
+}
+
+static void genChase(void)
+{
+    unsigned long long nodes = workingSet / NODE, i, j, tmp, cur;
+    unsigned long long *next;
+
+    if (nodes < 2) {
+        printf("Error: Working set too small to chase pointers\n");
+        exit(1);
+    }
+    /* Sattolo's shuffle gives a single cycle through every node */
+    next = malloc(sizeof(unsigned long long) * nodes);
+    if (!next) {
+        printf("Error: Cann't allocate %llu nodes\n", nodes);
+        exit(-1);
+    }
+    for (i = 0; i < nodes; i++)
+        next[i] = i;
+    for (i = nodes - 1; i > 0; i--) {
+        j = rnd() % i;
+        tmp = next[i];
+        next[i] = next[j];
+        next[j] = tmp;
+    }
+    for (cur = 0; emit('L', BASE_A + cur * NODE, 8); cur = next[cur])
+        ;
+    free(next);
+}
+
+static void genStencil(void)
+{
+    unsigned long long n = dim, i, j;
+    for (;;)
+        for (i = 1; i + 1 < n; i++)
+            for (j = 1; j + 1 < n; j++) {
+                if (!emit('L', BASE_A + ((i - 1) * n + j) * 8, 8) ||
+                    !emit('L', BASE_A + (i * n + j - 1) * 8, 8) ||
+                    !emit('L', BASE_A + (i * n + j) * 8, 8) ||
+                    !emit('L', BASE_A + (i * n + j + 1) * 8, 8) ||
+                    !emit('L', BASE_A + ((i + 1) * n + j) * 8, 8) ||
+                    !emit('S', BASE_B + (i * n + j) * 8, 8))
+                    return;
+            }
+}
+
+static void genGemm(void)
+{
+    unsigned long long n = dim, t = tile, ii, jj, kk, i, j, k;
+    for (;;)
+        for (ii = 0; ii < n; ii += t)
+            for (kk = 0; kk < n; kk += t)
+                for (jj = 0; jj < n; jj += t)
+                    for (i = ii; i < ii + t && i < n; i++)
+                        for (k = kk; k < kk + t && k < n; k++) {
+                            if (!emit('L', BASE_A + (i * n + k) * 8, 8))
+                                return;
+                            for (j = jj; j < jj + t && j < n; j++)
+                                if (!emit('L', BASE_B + (k * n + j) * 8, 8) ||
+                                    !emit('M', BASE_C + (i * n + j) * 8, 8))
+                                    return;
+                        }
+}
+
+static void genTranspose(void)
+{
+    unsigned long long n = dim, t = tile, ii, jj, i, j;
+    for (;;)
+        for (ii = 0; ii < n; ii += t)
+            for (jj = 0; jj < n; jj += t)
+                for (i = ii; i < ii + t && i < n; i++)
+                    for (j = jj; j < jj + t && j < n; j++)
+                        if (!emit('L', BASE_A + (i * n + j) * 4, 4) ||
+                            !emit('S', BASE_B + (j * n + i) * 4, 4))
+                            return;
+}
+
+static void genSweep(void)
+{
+    unsigned long long size, off;
+    int r;
+    for (;;)
+        for (size = 1024; size <= workingSet; size *= 2)
+            for (r = 0; r < repeat; r++)
+                for (off = 0; off < size; off += 64)
+                    if (!emit('L', BASE_A + off, 8))
+                        return;
+}
+
+static const struct pattern {
+    const char *name;
+    void (*gen)(void);
+} patterns[] = {
+    {"stride", genStride},
+    {"random", genRandom},
+    {"chase", genChase},
+    {"stencil", genStencil},
+    {"gemm", genGemm},
+    {"transpose", genTranspose},
+    {"sweep", genSweep},
+};
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char *argv[])
+{
+    int i;
+    printf("Usage: %s -p <pattern> [-c <count>] [-w <bytes>] [-S <stride>] [-n <dim>]\n"
+           "       [-t <tile>] [-r <repeat>] [-x <seed>] [-o <text>] [-B <binary>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -p <pattern> One of");
+    for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+        printf(" %s", patterns[i].name);
+    printf(".\n");
+    printf("  -c <count>   Number of accesses (default 1000000).\n");
+    printf("  -w <bytes>   Working set of stride, random, chase and sweep (default 1MB).\n");
+    printf("  -S <stride>  Stride in bytes (default 64).\n");
+    printf("  -n <dim>     Matrix side of stencil, gemm and transpose (default 256).\n");
+    printf("  -t <tile>    Tile side of gemm and transpose (default 8).\n");
+    printf("  -r <repeat>  Passes per working set of sweep (default 4).\n");
+    printf("  -x <seed>    Random seed (default 1).\n");
+    printf("  -o <text>    Write the text trace here (default stdout unless -B).\n");
+    printf("  -B <binary>  Write the binary trace here.\n");
+    printf("Example: %s -p chase -w 65536 -c 100000 -B chase.bin\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    char c;
+    char *pattern = NULL, *textPath = NULL, *binPath = NULL;
+    int i;
+
+    while ((c = getopt(argc, argv, "hp:c:w:S:n:t:r:x:o:B:")) != -1) {
+        switch (c) {
+        case 'p':
+            pattern = optarg;
+            break;
+        case 'c':
+            remaining = strtoull(optarg, NULL, 0);
+            break;
+        case 'w':
+            workingSet = strtoull(optarg, NULL, 0);
+            break;
+        case 'S':
+            stride = strtoull(optarg, NULL, 0);
+            break;
+        case 'n':
+            dim = atoi(optarg);
+            break;
+        case 't':
+            tile = atoi(optarg);
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        case 'x':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'o':
+            textPath = optarg;
+            break;
+        case 'B':
+            binPath = optarg;
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    for (i = 0; pattern && i < sizeof(patterns) / sizeof(patterns[0]); i++)
+        if (strcmp(pattern, patterns[i].name) == 0)
+            break;
+    if (!pattern || i == sizeof(patterns) / sizeof(patterns[0]) || remaining == 0 ||
+        workingSet < 8 || stride == 0 || dim < 3 || tile < 1 || repeat < 1 || seed == 0) {
+        printf("Error: Missing or invalid argument\n");
+        usage(argv);
+        exit(1);
+    }
+
+    if (textPath) {
+        textFp = fopen(textPath, "w");
+        if (!textFp) {
+            printf("Error: Cann't create file %s!\n", textPath);
+            exit(1);
+        }
+    } else if (!binPath) {
+        textFp = stdout;
+    }
+    if (binPath) {
+        if (binTraceWriterOpen(&binWriter, binPath) < 0) {
+            printf("Error: Cann't create file %s!\n", binPath);
+            exit(1);
+        }
+        binOpen = 1;
+    }
+
+    patterns[i].gen();
+
+    if (textFp && textFp != stdout)
+        fclose(textFp);
+    if (binOpen && binTraceWriterClose(&binWriter) < 0) {
+        printf("Error: Cann't write file %s!\n", binPath);
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * gentrans-check.c - Checks the kernels of gentrans.c against a naive
+ *     byte-wise transpose.
+ *
+ * Every supported element width (1, 2, 4, 8 and 16 bytes) goes through
+ * transposeElems, transposeSquare and transposeInPlace on square shapes,
+ * odd shapes that leave partial tiles, and, for the strided functions,
+ * leading dimensions padded past the matrix. The padding is filled with
+ * a sentinel that must come out untouched. The error returns for an
+ * unsupported width and a short leading dimension are checked too.
+ *
+ * Prints one line per failure and a summary, and exits 1 if any check
+ * failed (make check-gentrans).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gentrans.h"
+
+/* Byte the padding of every buffer is filled with */
+#define SENTINEL 0xa5
+
+/* Extra elements past the row in the padded leading dimensions */
+#define PAD_SRC 5
+#define PAD_DST 3
+
+static const size_t sizes[] = {1, 2, 4, 8, 16};
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+/* Square, odd and tile-crossing shapes (a width-1 tile is 64 wide) */
+static const int shapes[][2] = {
+    {1, 1}, {8, 8}, {32, 32}, {64, 64}, {65, 65},
+    {1, 13}, {13, 1}, {7, 3}, {61, 67}, {67, 61}, {130, 5}, {3, 129},
+};
+#define NUM_SHAPES (sizeof(shapes) / sizeof(shapes[0]))
+
+static int checks = 0;
+static int failures = 0;
+
+/*
+ * fill - Fill n bytes with a hashed pattern, so that a misplaced
+ *     element or byte shows up as a mismatch
+ */
+static void fill(unsigned char *p, size_t n, unsigned seed)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        p[i] = (unsigned char)((i * 2654435761u + seed) >> 13);
+}
+
+/*
+ * sameElem - Whether element (r, c) of a (leading dimension lda) and
+ *     element (c, r) of b (leading dimension ldb) hold the same bytes
+ */
+static int sameElem(const unsigned char *a, size_t lda, const unsigned char *b,
+                    size_t ldb, int r, int c, size_t size)
+{
+    return memcmp(a + ((size_t)r * lda + c) * size,
+                  b + ((size_t)c * ldb + r) * size, size) == 0;
+}
+
+/*
+ * paddingIntact - Whether the elements past the first cols of each of
+ *     rows rows (leading dimension ld) still hold the sentinel
+ */
+static int paddingIntact(const unsigned char *p, size_t ld, int rows, int cols,
+                         size_t size)
+{
+    int r;
+    size_t k;
+
+    for (r = 0; r < rows; r++)
+        for (k = (size_t)cols * size; k < ld * size; k++)
+            if (p[(size_t)r * ld * size + k] != SENTINEL)
+                return 0;
+    return 1;
+}
+
+/*
+ * report - Count one check and print it if it failed
+ */
+static void report(int ok, const char *what, size_t size, int rows, int cols,
+                   size_t lds, size_t ldd)
+{
+    checks++;
+    if (!ok) {
+        failures++;
+        printf("FAIL: %s size=%lu %dx%d ld=%lu/%lu\n", what,
+               (unsigned long)size, rows, cols, (unsigned long)lds,
+               (unsigned long)ldd);
+    }
+}
+
+/*
+ * checkElems - transposeElems of a rows x cols matrix, dense or padded
+ */
+static void checkElems(size_t size, int rows, int cols, int padded)
+{
+    size_t lds = cols + (padded ? PAD_SRC : 0);
+    size_t ldd = rows + (padded ? PAD_DST : 0);
+    unsigned char *src = malloc(rows * lds * size + 1);
+    unsigned char *dst = malloc(cols * ldd * size + 1);
+    int r, c, ok;
+
+    if (!src || !dst) {
+        printf("Error: Cann't allocate matrices!\n");
+        exit(-1);
+    }
+    memset(src, SENTINEL, rows * lds * size);
+    for (r = 0; r < rows; r++)
+        fill(src + r * lds * size, cols * size, r);
+    memset(dst, SENTINEL, cols * ldd * size);
+
+    ok = transposeElems(src, lds, dst, ldd, rows, cols, size) == 0;
+    for (r = 0; ok && r < rows; r++)
+        for (c = 0; ok && c < cols; c++)
+            ok = sameElem(src, lds, dst, ldd, r, c, size);
+    ok = ok && paddingIntact(dst, ldd, cols, rows, size);
+    report(ok, "transposeElems", size, rows, cols, lds, ldd);
+
+    free(src);
+    free(dst);
+}
+
+/*
+ * checkSquare - transposeSquare of an n x n matrix, dense or padded
+ */
+static void checkSquare(size_t size, int n, int padded)
+{
+    size_t ld = n + (padded ? PAD_SRC : 0);
+    unsigned char *a = malloc(n * ld * size + 1);
+    unsigned char *orig = malloc(n * ld * size + 1);
+    int r, c, ok;
+
+    if (!a || !orig) {
+        printf("Error: Cann't allocate matrices!\n");
+        exit(-1);
+    }
+    memset(a, SENTINEL, n * ld * size);
+    for (r = 0; r < n; r++)
+        fill(a + r * ld * size, n * size, r);
+    memcpy(orig, a, n * ld * size);
+
+    ok = transposeSquare(a, ld, n, size) == 0;
+    for (r = 0; ok && r < n; r++)
+        for (c = 0; ok && c < n; c++)
+            ok = sameElem(orig, ld, a, ld, r, c, size);
+    ok = ok && paddingIntact(a, ld, n, n, size);
+    report(ok, "transposeSquare", size, n, n, ld, ld);
+
+    free(a);
+    free(orig);
+}
+
+/*
+ * checkInPlace - transposeInPlace of a dense rows x cols matrix
+ */
+static void checkInPlace(size_t size, int rows, int cols)
+{
+    size_t bytes = (size_t)rows * cols * size;
+    unsigned char *a = malloc(bytes + 1);
+    unsigned char *orig = malloc(bytes + 1);
+    int r, c, ok;
+
+    if (!a || !orig) {
+        printf("Error: Cann't allocate matrices!\n");
+        exit(-1);
+    }
+    fill(a, bytes, rows);
+    memcpy(orig, a, bytes);
+
+    ok = transposeInPlace(a, rows, cols, size) == 0;
+    for (r = 0; ok && r < rows; r++)
+        for (c = 0; ok && c < cols; c++)
+            ok = sameElem(orig, cols, a, rows, r, c, size);
+    report(ok, "transposeInPlace", size, rows, cols, cols, rows);
+
+    free(a);
+    free(orig);
+}
+
+/*
+ * checkErrors - Unsupported widths and short leading dimensions
+ */
+static void checkErrors(void)
+{
+    char buf[64];
+
+    report(transposeElems(buf, 4, buf + 32, 4, 4, 4, 3) == -1,
+           "transposeElems bad size", 3, 4, 4, 4, 4);
+    report(transposeElems(buf, 3, buf + 32, 4, 4, 4, 1) == -1,
+           "transposeElems short lds", 1, 4, 4, 3, 4);
+    report(transposeElems(buf, 4, buf + 32, 3, 4, 4, 1) == -1,
+           "transposeElems short ldd", 1, 4, 4, 4, 3);
+    report(transposeSquare(buf, 4, 4, 32) == -1,
+           "transposeSquare bad size", 32, 4, 4, 4, 4);
+    report(transposeSquare(buf, 3, 4, 1) == -1,
+           "transposeSquare short ld", 1, 4, 4, 3, 3);
+    report(transposeInPlace(buf, 4, 4, 0) == -1,
+           "transposeInPlace bad size", 0, 4, 4, 4, 4);
+}
+
+int main(void)
+{
+    size_t s;
+    int i;
+
+    for (s = 0; s < NUM_SIZES; s++) {
+        for (i = 0; i < NUM_SHAPES; i++) {
+            checkElems(sizes[s], shapes[i][0], shapes[i][1], 0);
+            checkElems(sizes[s], shapes[i][0], shapes[i][1], 1);
+            checkInPlace(sizes[s], shapes[i][0], shapes[i][1]);
+            if (shapes[i][0] == shapes[i][1]) {
+                checkSquare(sizes[s], shapes[i][0], 0);
+                checkSquare(sizes[s], shapes[i][0], 1);
+            }
+        }
+        /* Odd squares for the in-place square kernel's partial tiles */
+        checkSquare(sizes[s], 7, 1);
+        checkSquare(sizes[s], 61, 0);
+        checkSquare(sizes[s], 61, 1);
+    }
+    checkErrors();
+
+    printf("gentrans: %d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
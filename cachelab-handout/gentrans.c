@@ -0,0 +1,164 @@
+/*
+ * gentrans.c - Transpose of any element width, see gentrans.h
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include "gentrans.h"
+
+/* Width of the tile row in bytes: one cache line (32 for the grading cache) */
+#ifndef TILE_BYTES
+#define TILE_BYTES 64
+#endif
+
+/* 16-byte element, copied as a whole by struct assignment */
+typedef struct {
+    uint64_t w[2];
+} elem128_t;
+
+/* Bits in a word of the visited bitset */
+#define WORD_BITS (8 * sizeof(unsigned long))
+
+/*
+ * DEFINE_KERNELS - Out-of-place and in-place kernels for one element
+ *     type. Tiles are TILE_BYTES / sizeof(TYPE) elements on a side.
+ *
+ * The non-square in-place kernel follows cycles of the permutation that
+ * sends index k of the rows x cols matrix to k * rows mod (rows*cols - 1)
+ * in the transpose. Each cycle is rotated once through a carried
+ * element, and a bitset marks the indices already placed so that every
+ * cycle is rotated only once.
+ */
+#define DEFINE_KERNELS(NAME, TYPE)                                          \
+static void NAME##Copy(const void *s, size_t lds, void *d, size_t ldd,      \
+                       int rows, int cols)                                  \
+{                                                                           \
+    const TYPE *src = s;                                                    \
+    TYPE *dst = d;                                                          \
+    const int tile = TILE_BYTES / sizeof(TYPE);                             \
+    int row, col, i, j, row_end, col_end;                                   \
+                                                                            \
+    for (row = 0; row < rows; row += tile) {                                \
+        row_end = row + tile < rows ? row + tile : rows;                    \
+        for (col = 0; col < cols; col += tile) {                            \
+            col_end = col + tile < cols ? col + tile : cols;                \
+            for (i = row; i < row_end; i++)                                 \
+                for (j = col; j < col_end; j++)                             \
+                    dst[j * ldd + i] = src[i * lds + j];                    \
+        }                                                                   \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static void NAME##Square(void *p, size_t ld, int n)                        \
+{                                                                           \
+    TYPE *a = p;                                                            \
+    TYPE tmp;                                                               \
+    const int tile = TILE_BYTES / sizeof(TYPE);                             \
+    int row, col, i, j, row_end, col_end;                                   \
+                                                                            \
+    /* swap each tile above the diagonal with its mirror below it */       \
+    for (row = 0; row < n; row += tile) {                                   \
+        row_end = row + tile < n ? row + tile : n;                          \
+        for (col = row; col < n; col += tile) {                             \
+            col_end = col + tile < n ? col + tile : n;                      \
+            for (i = row; i < row_end; i++)                                 \
+                for (j = (col == row ? i + 1 : col); j < col_end; j++) {    \
+                    tmp = a[i * ld + j];                                    \
+                    a[i * ld + j] = a[j * ld + i];                          \
+                    a[j * ld + i] = tmp;                                    \
+                }                                                           \
+        }                                                                   \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static int NAME##InPlace(void *p, int rows, int cols)                       \
+{                                                                           \
+    TYPE *a = p;                                                            \
+    TYPE carry, tmp;                                                        \
+    size_t last = (size_t)rows * cols - 1;                                  \
+    size_t start, k;                                                        \
+    unsigned long *visited;                                                 \
+                                                                            \
+    if (rows < 2 || cols < 2)                                               \
+        return 0;       /* a vector is its own transpose in memory */       \
+    visited = calloc(last / WORD_BITS + 1, sizeof(unsigned long));          \
+    if (!visited)                                                           \
+        return -1;                                                          \
+    /* the first and last elements never move */                            \
+    for (start = 1; start < last; start++) {                                \
+        if (visited[start / WORD_BITS] & (1UL << (start % WORD_BITS)))      \
+            continue;                                                       \
+        carry = a[start];                                                   \
+        k = start;                                                          \
+        do {                                                                \
+            k = k * rows % last;                                            \
+            tmp = a[k];                                                     \
+            a[k] = carry;                                                   \
+            carry = tmp;                                                    \
+            visited[k / WORD_BITS] |= 1UL << (k % WORD_BITS);               \
+        } while (k != start);                                               \
+    }                                                                       \
+    free(visited);                                                          \
+    return 0;                                                               \
+}
+
+DEFINE_KERNELS(trans8, uint8_t)
+DEFINE_KERNELS(trans16, uint16_t)
+DEFINE_KERNELS(trans32, uint32_t)
+DEFINE_KERNELS(trans64, uint64_t)
+DEFINE_KERNELS(trans128, elem128_t)
+
+/* The kernels for each supported width */
+static const struct kernels {
+    size_t size;
+    void (*copy)(const void *src, size_t lds, void *dst, size_t ldd, int rows, int cols);
+    void (*square)(void *a, size_t ld, int n);
+    int (*inplace)(void *a, int rows, int cols);
+} kernels[] = {
+    {1, trans8Copy, trans8Square, trans8InPlace},
+    {2, trans16Copy, trans16Square, trans16InPlace},
+    {4, trans32Copy, trans32Square, trans32InPlace},
+    {8, trans64Copy, trans64Square, trans64InPlace},
+    {16, trans128Copy, trans128Square, trans128InPlace},
+};
+
+/*
+ * findKernels - The kernels for size-byte elements, or NULL
+ */
+static const struct kernels *findKernels(size_t size)
+{
+    int i;
+    for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+        if (kernels[i].size == size)
+            return &kernels[i];
+    return NULL;
+}
+
+int transposeElems(const void *src, size_t lds, void *dst, size_t ldd,
+                   int rows, int cols, size_t size)
+{
+    const struct kernels *k = findKernels(size);
+
+    if (!k || rows < 0 || cols < 0 || lds < (size_t)cols || ldd < (size_t)rows)
+        return -1;
+    k->copy(src, lds, dst, ldd, rows, cols);
+    return 0;
+}
+
+int transposeSquare(void *a, size_t ld, int n, size_t size)
+{
+    const struct kernels *k = findKernels(size);
+
+    if (!k || n < 0 || ld < (size_t)n)
+        return -1;
+    k->square(a, ld, n);
+    return 0;
+}
+
+int transposeInPlace(void *a, int rows, int cols, size_t size)
+{
+    const struct kernels *k = findKernels(size);
+
+    if (!k || rows < 0 || cols < 0)
+        return -1;
+    return k->inplace(a, rows, cols);
+}
@@ -0,0 +1,40 @@
+/*
+ * gentrans.h - Transpose of any element type with 1, 2, 4, 8 or 16 byte
+ *     elements (char, short, int/float, double, double complex)
+ *
+ * Matrices are row-major with a leading dimension, the distance in
+ * elements between the starts of consecutive rows, so a submatrix of a
+ * larger array is passed as a pointer to its first element plus the
+ * leading dimension of the whole array. Every width has its own kernel,
+ * tiled so that a tile row spans one 64-byte cache line.
+ */
+
+#ifndef CACHELAB_GENTRANS_H
+#define CACHELAB_GENTRANS_H
+
+#include <stddef.h>
+
+/*
+ * transposeElems - Write the transpose of the rows x cols matrix at src
+ *     (leading dimension lds) to the cols x rows matrix at dst (leading
+ *     dimension ldd). src and dst must not overlap. Returns 0, or -1 if
+ *     size is not a supported width or a leading dimension is too small.
+ */
+int transposeElems(const void *src, size_t lds, void *dst, size_t ldd,
+                   int rows, int cols, size_t size);
+
+/*
+ * transposeSquare - Transpose the n x n matrix at a (leading dimension
+ *     ld) in place. Returns 0, or -1 as for transposeElems.
+ */
+int transposeSquare(void *a, size_t ld, int n, size_t size);
+
+/*
+ * transposeInPlace - Transpose the dense rows x cols matrix at a in
+ *     place, leaving it a dense cols x rows matrix. Needs a bitset of
+ *     rows*cols bits on the heap. Returns 0, or -1 if size is not a
+ *     supported width or the bitset cannot be allocated.
+ */
+int transposeInPlace(void *a, int rows, int cols, size_t size);
+
+#endif /* CACHELAB_GENTRANS_H */
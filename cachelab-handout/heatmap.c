@@ -0,0 +1,387 @@
+/*
+ * heatmap.c - Map the misses of a transpose trace back to the elements
+ *     of A and B, to see which elements conflict in the cache.
+ *
+ * The trace (trace.f<i> from test-trans, or a binary capture from
+ * tracegen-cap) is replayed on the cache model the way test-trans
+ * scores it. Every access is attributed to the element of A (N rows of
+ * M ints) or B (M rows of N ints) it touches, and each element counts
+ * its accesses, its misses and the lines of A and of B its misses
+ * evicted: evictions of the other matrix show A/B conflicts such as the
+ * diagonal, evictions of the same matrix show self conflicts such as
+ * B's rows four apart at 64x64.
+ *
+ * A and B are tracegen's static arrays. Their addresses can be given
+ * with -A and -B; by default they are read from <trace>.bases, which
+ * test-trans writes next to trace.f<i> from what tracegen -S prints.
+ * Without it they are guessed from the trace: B is the lowest address
+ * stored to and A the lowest address loaded outside B, which a correct
+ * transpose always touches, since it writes every element of B and
+ * reads every one of A. Accesses narrower than an int, such as the
+ * one-byte marker stores test-trans keeps in trace.f<i>, are ignored.
+ *
+ * The counts are written as CSV (one row per element) and the misses
+ * as two PGM images on one scale, one square of pixels
+ * per element.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "cache.h"
+#include "bintrace.h"
+
+/* One trace record */
+struct access {
+    unsigned long addr;
+    int size;
+    char op;
+};
+
+/* Counts of one element */
+struct cell {
+    unsigned int accesses;
+    unsigned int misses;
+    unsigned int evictA;   /* lines of A evicted by its misses */
+    unsigned int evictB;   /* lines of B evicted by its misses */
+};
+
+/* A matrix as laid out in tracegen */
+struct matrix {
+    const char *name;
+    unsigned long base;
+    int rows, cols;
+    struct cell *cells;
+};
+
+static struct access *trace;
+static size_t traceNum, traceCap;
+static struct matrix mats[2];
+static struct Cache cache;
+static unsigned int otherMisses;
+
+static void addAccess(char op, unsigned long addr, int size)
+{
+    if (traceNum == traceCap) {
+        traceCap = traceCap ? traceCap * 2 : 65536;
+        trace = realloc(trace, traceCap * sizeof(struct access));
+        if (!trace) {
+            printf("Error: Cann't allocate the trace!\n");
+            exit(-1);
+        }
+    }
+    trace[traceNum].addr = addr;
+    trace[traceNum].size = size;
+    trace[traceNum].op = op;
+    traceNum++;
+}
+
+/*
+ * readTrace - Load a binary or text trace into memory
+ */
+static void readTrace(const char *path)
+{
+    struct binTrace bt;
+    unsigned long long addr64;
+    unsigned long addr;
+    char op, buf[256];
+    int size;
+    FILE *fp;
+
+    int status = binTraceOpen(&bt, path);
+    if (status < 0) {
+        printf("Error: Cann't open file %s!\n", path);
+        exit(-1);
+    }
+    if (status == 0) {
+        while (binTraceNext(&bt, &op, &addr64, &size))
+            if (op != 'I')
+                addAccess(op, (unsigned long)addr64, size);
+        binTraceClose(&bt);
+        return;
+    }
+    fp = fopen(path, "r");
+    if (!fp) {
+        printf("Error: Cann't open file %s!\n", path);
+        exit(-1);
+    }
+    while (fgets(buf, sizeof(buf), fp))
+        if (buf[0] == ' ' && sscanf(buf, " %c %lx,%d", &op, &addr, &size) == 3)
+            addAccess(op, addr, size);
+    fclose(fp);
+}
+
+/* the element holding addr, NULL outside A and B */
+static struct cell *cellOf(unsigned long addr, int *which)
+{
+    for (int k = 0; k < 2; k++) {
+        unsigned long off = addr - mats[k].base;
+        if (off < (unsigned long)mats[k].rows * mats[k].cols * sizeof(int)) {
+            if (which)
+                *which = k;
+            return &mats[k].cells[off / sizeof(int)];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * readBases - Take the addresses not given on the command line from
+ *     <path>.bases, "A B" in hex, if there is one
+ */
+static void readBases(const char *path, int *haveA, int *haveB)
+{
+    char name[300];
+    unsigned long a, b;
+    FILE *fp;
+
+    snprintf(name, sizeof(name), "%s.bases", path);
+    fp = fopen(name, "r");
+    if (!fp)
+        return;
+    if (fscanf(fp, "%lx %lx", &a, &b) == 2) {
+        if (!*haveA)
+            mats[0].base = a;
+        if (!*haveB)
+            mats[1].base = b;
+        *haveA = *haveB = 1;
+    }
+    fclose(fp);
+}
+
+/*
+ * guessBases - B is the lowest address stored to, A the lowest address
+ *     loaded outside B, both ignoring accesses narrower than an int
+ */
+static void guessBases(int M, int N, int haveA, int haveB)
+{
+    unsigned long lowStore = ~0UL, lowLoad = ~0UL;
+    size_t i;
+
+    for (i = 0; !haveB && i < traceNum; i++)
+        if (trace[i].op != 'L' && trace[i].size >= (int)sizeof(int) &&
+            trace[i].addr < lowStore)
+            lowStore = trace[i].addr;
+    if (!haveB)
+        mats[1].base = lowStore;
+    for (i = 0; !haveA && i < traceNum; i++)
+        if (trace[i].op != 'S' && trace[i].size >= (int)sizeof(int) &&
+            trace[i].addr < lowLoad &&
+            trace[i].addr - mats[1].base >= (unsigned long)M * N * sizeof(int))
+            lowLoad = trace[i].addr;
+    if (!haveA)
+        mats[0].base = lowLoad;
+    if (mats[0].base == ~0UL || mats[1].base == ~0UL) {
+        printf("Error: Cann't find A and B in the trace, give them with -A and -B\n");
+        exit(-1);
+    }
+}
+
+/*
+ * play - Play one access of element c on the cache as test-trans does,
+ *     probing every line a vector access touches
+ */
+static void play(unsigned long addr, int size, int write, struct cell *c)
+{
+    unsigned long line, last = (addr + (size > 1 ? size - 1 : 0)) >> cache.b;
+    struct Victim victim;
+    int which;
+
+    if (c)
+        c->accesses++;
+    for (line = addr >> cache.b; line <= last; line++) {
+        if (probe(&cache, line << cache.b, write))
+            continue;
+        victim = fill(&cache, line << cache.b, write);
+        if (!c) {
+            otherMisses++;
+            continue;
+        }
+        c->misses++;
+        if (victim.valid && cellOf(victim.address, &which)) {
+            if (which == 0)
+                c->evictA++;
+            else
+                c->evictB++;
+        }
+    }
+}
+
+/*
+ * writePgm - Write the misses of matrix m as a binary PGM, zoom pixels
+ *     per element, on a scale where max misses is white
+ */
+static void writePgm(const char *path, struct matrix *m, int zoom, unsigned int max)
+{
+    FILE *fp = fopen(path, "wb");
+    int r, c, y;
+
+    if (!fp) {
+        printf("Error: Cann't create file %s!\n", path);
+        exit(-1);
+    }
+    fprintf(fp, "P5\n%d %d\n255\n", m->cols * zoom, m->rows * zoom);
+    for (r = 0; r < m->rows; r++)
+        for (y = 0; y < zoom; y++)
+            for (c = 0; c < m->cols * zoom; c++)
+                putc(max ? m->cells[r * m->cols + c / zoom].misses * 255 / max : 0, fp);
+    fclose(fp);
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] -M <M> -N <N> [-f <i> | -t <trace>] [-s <s>] [-E <E>] [-b <b>]\n"
+           "       [-A <addr>] [-B <addr>] [-o <prefix>] [-z <zoom>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -M <M>      Columns of A, rows of B.\n");
+    printf("  -N <N>      Rows of A, columns of B.\n");
+    printf("  -f <i>      Analyse trace.f<i> (default 0).\n");
+    printf("  -t <trace>  Analyse this text or binary trace instead.\n");
+    printf("  -s <s>      Number of set index bits (default 5).\n");
+    printf("  -E <E>      Associativity (default 1).\n");
+    printf("  -b <b>      Number of block bits (default 5).\n");
+    printf("  -A <addr>   Address of A in hex (default from <trace>.bases or the trace).\n");
+    printf("  -B <addr>   Address of B in hex (default from <trace>.bases or the trace).\n");
+    printf("  -o <prefix> Write <prefix>.csv, <prefix>-A.pgm and <prefix>-B.pgm (default heatmap).\n");
+    printf("  -z <zoom>   Pixels per element side in the images (default 4).\n");
+    printf("Example: %s -M 64 -N 64 -f 0 -o f0\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    char c;
+    char defaultPath[32] = "trace.f0", name[300];
+    char *path = defaultPath;
+    const char *prefix = "heatmap";
+    int M = 0, N = 0, s = 5, E = 1, b = 5, zoom = 4;
+    int haveA = 0, haveB = 0;
+    unsigned int max = 0;
+    size_t i;
+    int k, r, col;
+    FILE *fp;
+
+    while ((c = getopt(argc, argv, "hM:N:f:t:s:E:b:A:B:o:z:")) != -1) {
+        switch (c) {
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 'f':
+            snprintf(defaultPath, sizeof(defaultPath), "trace.f%d", atoi(optarg));
+            path = defaultPath;
+            break;
+        case 't':
+            path = optarg;
+            break;
+        case 's':
+            s = atoi(optarg);
+            break;
+        case 'E':
+            E = atoi(optarg);
+            break;
+        case 'b':
+            b = atoi(optarg);
+            break;
+        case 'A':
+            mats[0].base = strtoul(optarg, NULL, 16);
+            haveA = 1;
+            break;
+        case 'B':
+            mats[1].base = strtoul(optarg, NULL, 16);
+            haveB = 1;
+            break;
+        case 'o':
+            prefix = optarg;
+            break;
+        case 'z':
+            zoom = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (M < 1 || N < 1 || s < 0 || E < 1 || b < 2 || zoom < 1) {
+        printf("Error: Missing or invalid argument\n");
+        usage(argv);
+        exit(1);
+    }
+
+    mats[0].name = "A";
+    mats[0].rows = N;
+    mats[0].cols = M;
+    mats[1].name = "B";
+    mats[1].rows = M;
+    mats[1].cols = N;
+    for (k = 0; k < 2; k++) {
+        mats[k].cells = calloc((size_t)M * N, sizeof(struct cell));
+        if (!mats[k].cells) {
+            printf("Error: Cann't allocate the heatmap!\n");
+            exit(-1);
+        }
+    }
+
+    readTrace(path);
+    readBases(path, &haveA, &haveB);
+    guessBases(M, N, haveA, haveB);
+
+    /* M is a load and a store, like csim-ref */
+    initialCache(&cache, s, E, b, findPolicy("lru"));
+    for (i = 0; i < traceNum; i++) {
+        struct cell *cl = cellOf(trace[i].addr, NULL);
+        play(trace[i].addr, trace[i].size, trace[i].op == 'S', cl);
+        if (trace[i].op == 'M')
+            play(trace[i].addr, trace[i].size, 1, cl);
+    }
+    printf("hits:%d misses:%d evictions:%d\n", cache.hitCount, cache.missCount, cache.evictCount);
+    freeCache(&cache);
+
+    snprintf(name, sizeof(name), "%s.csv", prefix);
+    fp = fopen(name, "w");
+    if (!fp) {
+        printf("Error: Cann't create file %s!\n", name);
+        exit(-1);
+    }
+    fprintf(fp, "matrix,row,col,accesses,misses,evicted_A,evicted_B\n");
+    for (k = 0; k < 2; k++) {
+        struct matrix *m = &mats[k];
+        unsigned int acc = 0, miss = 0, evA = 0, evB = 0;
+        for (r = 0; r < m->rows; r++)
+            for (col = 0; col < m->cols; col++) {
+                struct cell *cl = &m->cells[r * m->cols + col];
+                fprintf(fp, "%s,%d,%d,%u,%u,%u,%u\n", m->name, r, col,
+                        cl->accesses, cl->misses, cl->evictA, cl->evictB);
+                acc += cl->accesses;
+                miss += cl->misses;
+                evA += cl->evictA;
+                evB += cl->evictB;
+                if (cl->misses > max)
+                    max = cl->misses;
+            }
+        printf("%s at %lx (%dx%d): accesses:%u misses:%u evicted_A:%u evicted_B:%u\n",
+               m->name, m->base, m->rows, m->cols, acc, miss, evA, evB);
+    }
+    if (otherMisses)
+        printf("misses outside A and B: %u\n", otherMisses);
+    fclose(fp);
+
+    for (k = 0; k < 2; k++) {
+        snprintf(name, sizeof(name), "%s-%s.pgm", prefix, mats[k].name);
+        writePgm(name, &mats[k], zoom, max);
+    }
+    printf("Wrote %s.csv, %s-A.pgm and %s-B.pgm\n", prefix, prefix, prefix);
+
+    free(trace);
+    free(mats[0].cells);
+    free(mats[1].cells);
+    return 0;
+}
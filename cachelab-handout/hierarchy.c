@@ -0,0 +1,259 @@
+/*
+ * hierarchy.c - Multi-level cache hierarchy simulation
+ *
+ *  L1D is the cache given by -s, -E and -b. An optional L1I serves
+ *  the instruction fetches, and the levels below are shared by both.
+ *  The inclusion policy of a level says how it relates to the levels
+ *  above it:
+ *  	inclusive  every block above is also here, so a victim here is
+ *  	           invalidated in all levels above
+ *  	exclusive  only victims from the level above are filled here,
+ *  	           and a hit moves the block up and out of this level
+ *  	nine       neither, blocks are filled on the way up and victims
+ *  	           leave silently unless dirty
+ *  Dirty victims are written back to the next level, or to memory
+ *  from the last one, and counted as writebacks of the level.
+ *  Without write allocate, an L1D store miss writes through to the
+ *  next level instead of filling L1D. A writeback or write-through
+ *  counts as a store to the level it reaches: a hit if the block is
+ *  there, otherwise a miss that allocates it, so no level evicts more
+ *  than it misses.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hierarchy.h"
+#include "attrib.h"
+
+enum { NINE, INCLUSIVE, EXCLUSIVE };
+static const char *inclusionNames[] = {"nine", "inclusive", "exclusive"};
+
+struct Level {
+	char name[16];
+	int s, E, b, inclusion;
+	int depth;                  /* index in lower, -1 for the L1s */
+	struct Cache own;
+	struct Cache *cache;
+};
+
+static char *specs[MAX_LEVELS];
+static int specNum = 0;
+
+static struct Level l1d, l1i;
+static struct Level lower[MAX_LEVELS];
+static int lowerNum = 0, hasL1I = 0;
+
+/* blocks moved between the last level and memory */
+static unsigned long memReads = 0, memWrites = 0;
+
+extern int vFlag, writeAllocate;
+
+/* queue a level spec "name:s:E:b[:inclusive|exclusive|nine]" */
+void hierAddLevel(char *spec) {
+	if(specNum == MAX_LEVELS) {
+		printf("Error: At most %d cache levels!\n", MAX_LEVELS);
+		exit(-1);
+	}
+	specs[specNum++] = spec;
+}
+
+/* number of levels queued besides L1D */
+int hierLevels(void) {
+	return specNum;
+}
+
+/* parse a level spec, exit on a malformed one */
+static void parseLevel(char *spec, struct Level *level) {
+	char inclusion[16] = "nine";
+	int n = sscanf(spec, "%15[^:]:%d:%d:%d:%15s", level->name,
+		&level->s, &level->E, &level->b, inclusion);
+	if(n < 4 || level->s < 0 || level->E < 1 || level->b < 0) {
+		printf("Error: Bad cache level %s, expected name:s:E:b[:inclusion]\n", spec);
+		exit(-1);
+	}
+	level->inclusion = -1;
+	for(int i = 0; i < 3; i++) {
+		if(strcmp(inclusion, inclusionNames[i]) == 0) {
+			level->inclusion = i;
+		}
+	}
+	if(level->inclusion < 0) {
+		printf("Error: Unknown inclusion policy %s, use one of inclusive, exclusive, nine\n", inclusion);
+		exit(-1);
+	}
+}
+
+/* build the hierarchy below the L1D cache, all levels use one policy */
+void hierInit(struct Cache *l1dCache, const struct Policy *policy) {
+	strcpy(l1d.name, "L1D");
+	l1d.s = l1dCache->s;
+	l1d.E = l1dCache->E;
+	l1d.b = l1dCache->b;
+	l1d.inclusion = NINE;
+	l1d.depth = -1;
+	l1d.cache = l1dCache;
+
+	for(int i = 0; i < specNum; i++) {
+		struct Level level;
+		memset(&level, 0, sizeof(level));
+		parseLevel(specs[i], &level);
+		if(level.b != l1d.b) {
+			printf("Error: Level %s must use the L1D block size b=%d\n", level.name, l1d.b);
+			exit(-1);
+		}
+		if(strcmp(level.name, "L1I") == 0) {
+			level.inclusion = NINE;
+			level.depth = -1;
+			l1i = level;
+			hasL1I = 1;
+		}else {
+			level.depth = lowerNum;
+			lower[lowerNum++] = level;
+		}
+	}
+	if(hasL1I) {
+		initialCache(&l1i.own, l1i.s, l1i.E, l1i.b, policy);
+		l1i.cache = &l1i.own;
+	}
+	for(int j = 0; j < lowerNum; j++) {
+		initialCache(&lower[j].own, lower[j].s, lower[j].E, lower[j].b, policy);
+		lower[j].cache = &lower[j].own;
+	}
+}
+
+/* invalidate an address in every level above, return 1 if any copy was dirty */
+static int backInvalidate(struct Level *level, unsigned long address) {
+	int dirty = invalidate(l1d.cache, address) > 0;
+	if(hasL1I) {
+		dirty |= invalidate(l1i.cache, address) > 0;
+	}
+	for(int j = 0; j < level->depth; j++) {
+		dirty |= invalidate(lower[j].cache, address) > 0;
+	}
+	return dirty;
+}
+
+static void evicted(struct Level *level, int next, struct Victim victim);
+
+/* dirty data written back into lower[j] as a store, allocating it on a miss */
+static void writeBack(int j, unsigned long address) {
+	if(j == lowerNum) {
+		memWrites++;
+		return;
+	}
+	if(probe(lower[j].cache, address, 1)) {
+		return;
+	}
+	evicted(&lower[j], j + 1, fill(lower[j].cache, address, 1));
+}
+
+/* a victim left level, whose next lower level is lower[next] */
+static void evicted(struct Level *level, int next, struct Victim victim) {
+	if(!victim.valid) {
+		return;
+	}
+	/* a dirty copy above makes a clean victim a writeback too */
+	if(level->inclusion == INCLUSIVE && backInvalidate(level, victim.address) && !victim.dirty) {
+		victim.dirty = 1;
+		level->cache->writebackCount++;
+	}
+	if(next < lowerNum && lower[next].inclusion == EXCLUSIVE) {
+		/* the block may be there already, e.g. a victim of both L1I and L1D */
+		struct Cache *cache = lower[next].cache;
+		if(victim.dirty ? markDirty(cache, victim.address) : contains(cache, victim.address)) {
+			return;
+		}
+		evicted(&lower[next], next + 1, fill(cache, victim.address, victim.dirty));
+	}else if(victim.dirty) {
+		writeBack(next, victim.address);
+	}
+}
+
+/* bring an address up out of lower[j], return 1 if the data is dirty */
+static int request(int j, unsigned long address) {
+	if(j == lowerNum) {
+		memReads++;
+		return 0;
+	}
+	struct Level *level = &lower[j];
+	if(probe(level->cache, address, 0)) {
+		if(level->inclusion == EXCLUSIVE) {
+			return invalidate(level->cache, address) > 0;
+		}
+		return 0;
+	}
+	int dirty = request(j + 1, address);
+	if(level->inclusion == EXCLUSIVE) {
+		return dirty;
+	}
+	evicted(level, j + 1, fill(level->cache, address, dirty));
+	return 0;
+}
+
+/* access an L1 cache */
+static void accessL1(struct Level *level, unsigned long address, int write, int size) {
+	if(probe(level->cache, address, write)) {
+		if(vFlag) {
+			printf("hit ");
+		}
+		return;
+	}
+	if(vFlag) {
+		printf("miss ");
+	}
+	if(write && !writeAllocate) {
+		level->cache->writeBytes += size;
+		writeBack(0, address);
+		if(attribFlag && level == &l1d) {
+			attribMiss(address, 0);
+		}
+		return;
+	}
+	int dirty = request(0, address);
+	struct Victim victim = fill(level->cache, address, dirty || write);
+	if(victim.valid && vFlag) {
+		printf("eviction ");
+	}
+	if(attribFlag && level == &l1d) {
+		attribMiss(address, victim.valid);
+	}
+	evicted(level, 0, victim);
+}
+
+/* simulate one trace record through the hierarchy */
+void hierAccess(char op, unsigned long address, int size) {
+	if(op == 'I' && hasL1I) {
+		accessL1(&l1i, address, 0, size);
+	}
+	if(op == 'L') {
+		accessL1(&l1d, address, 0, size);
+	}
+	if(op == 'S') {
+		accessL1(&l1d, address, 1, size);
+	}
+	if(op == 'M') {
+		accessL1(&l1d, address, 0, size);
+		accessL1(&l1d, address, 1, size);
+	}
+}
+
+static void reportLevel(struct Level *level) {
+	printf("%s hits:%d misses:%d evictions:%d writebacks:%lu\n", level->name,
+		level->cache->hitCount, level->cache->missCount,
+		level->cache->evictCount, level->cache->writebackCount);
+}
+
+/* print per-level counters and free the levels */
+void hierReport(void) {
+	if(hasL1I) {
+		reportLevel(&l1i);
+		freeCache(l1i.cache);
+	}
+	reportLevel(&l1d);
+	for(int j = 0; j < lowerNum; j++) {
+		reportLevel(&lower[j]);
+		freeCache(lower[j].cache);
+	}
+	printf("memory bytes_read:%lu bytes_written:%lu\n", memReads << l1d.b, memWrites << l1d.b);
+}
@@ -0,0 +1,27 @@
+/*
+ * hierarchy.h - Multi-level cache hierarchy simulation
+ */
+
+#ifndef CACHELAB_HIERARCHY_H
+#define CACHELAB_HIERARCHY_H
+
+#include "cache.h"
+
+#define MAX_LEVELS 8
+
+/* queue a level spec "name:s:E:b[:inclusive|exclusive|nine]" */
+void hierAddLevel(char *spec);
+
+/* number of levels queued besides L1D */
+int hierLevels(void);
+
+/* build the hierarchy below the L1D cache, all levels use one policy */
+void hierInit(struct Cache *l1d, const struct Policy *policy);
+
+/* simulate one trace record through the hierarchy */
+void hierAccess(char op, unsigned long address, int size);
+
+/* print per-level counters and free the levels */
+void hierReport(void);
+
+#endif /* CACHELAB_HIERARCHY_H */
@@ -0,0 +1,202 @@
+/*
+ * partrans.c - Multithreaded tiled transpose, see partrans.h
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "partrans.h"
+
+struct pool {
+    int threads;
+    pthread_t *tids;
+    pthread_mutex_t lock;
+    pthread_cond_t start;      /* signalled when a new job is posted */
+    pthread_cond_t done;       /* signalled when the last worker finishes */
+    unsigned long generation;  /* bumped once per job */
+    int running;               /* workers still busy with the job */
+    int stop;
+    void (*fn)(void *arg, int id);
+    void *arg;
+};
+
+struct worker {
+    struct pool *pool;
+    int id;
+};
+
+/*
+ * workerMain - Wait for a job, run this worker's share, repeat
+ */
+static void *workerMain(void *p)
+{
+    struct worker *w = p;
+    struct pool *pool = w->pool;
+    unsigned long seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->stop)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->fn(pool->arg, w->id);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    free(w);
+    return NULL;
+}
+
+struct pool *poolCreate(int threads)
+{
+    struct pool *pool = calloc(1, sizeof(struct pool));
+    int i;
+
+    if (!pool || threads < 1 || !(pool->tids = malloc(sizeof(pthread_t) * threads))) {
+        printf("Error: Cann't create a pool of %d threads\n", threads);
+        exit(-1);
+    }
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (i = 0; i < threads; i++) {
+        struct worker *w = malloc(sizeof(struct worker));
+        if (!w) {
+            printf("Error: Cann't create a pool of %d threads\n", threads);
+            exit(-1);
+        }
+        w->pool = pool;
+        w->id = i;
+        if (pthread_create(&pool->tids[i], NULL, workerMain, w)) {
+            printf("Error: Cann't start thread %d\n", i);
+            exit(-1);
+        }
+    }
+    return pool;
+}
+
+int poolThreads(const struct pool *pool)
+{
+    return pool->threads;
+}
+
+void poolRun(struct pool *pool, void (*fn)(void *arg, int id), void *arg)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->running = pool->threads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->running > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void poolDestroy(struct pool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->threads; i++)
+        pthread_join(pool->tids[i], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->tids);
+    free(pool);
+}
+
+/* Arguments shared by the workers of one parallel call */
+struct job {
+    int M, N, tile, threads;
+    const int *A;
+    int *A_init;
+    int *B;
+};
+
+/*
+ * band - The columns of A (rows of B) worker id owns: whole tiles, split
+ *     as evenly as possible
+ */
+static void band(const struct job *job, int id, int *start, int *end)
+{
+    long tiles = (job->M + job->tile - 1) / job->tile;
+
+    *start = (int)(tiles * id / job->threads) * job->tile;
+    *end = (int)(tiles * (id + 1) / job->threads) * job->tile;
+    if (*end > job->M)
+        *end = job->M;
+}
+
+/*
+ * touchWorker - Initialize A's rows by static row band and B's rows by
+ *     the band this worker will later write
+ */
+static void touchWorker(void *arg, int id)
+{
+    struct job *job = arg;
+    size_t M = job->M, N = job->N;
+    size_t i, j, row_start, row_end;
+    int start, end;
+
+    row_start = N * id / job->threads;
+    row_end = N * (id + 1) / job->threads;
+    for (i = row_start; i < row_end; i++)
+        for (j = 0; j < M; j++)
+            job->A_init[i * M + j] = (int)(i * M + j);
+
+    band(job, id, &start, &end);
+    if (start < end)
+        memset(job->B + start * N, 0, sizeof(int) * N * (end - start));
+}
+
+/*
+ * transWorker - Transpose this worker's band of A's columns, tile by
+ *     tile down the rows of A
+ */
+static void transWorker(void *arg, int id)
+{
+    struct job *job = arg;
+    const int *A = job->A;
+    int *B = job->B;
+    size_t M = job->M, N = job->N, tile = job->tile;
+    size_t row, col, i, j, row_end, col_end;
+    int start, end;
+
+    band(job, id, &start, &end);
+    for (row = 0; row < N; row += tile) {
+        row_end = row + tile < N ? row + tile : N;
+        for (col = start; col < end; col += tile) {
+            col_end = col + tile < end ? col + tile : end;
+            for (i = row; i < row_end; i++)
+                for (j = col; j < col_end; j++)
+                    B[j * N + i] = A[i * M + j];
+        }
+    }
+}
+
+void parFirstTouch(struct pool *pool, int M, int N, int *A, int *B, int tile)
+{
+    struct job job = {M, N, tile, poolThreads(pool), A, A, B};
+    poolRun(pool, touchWorker, &job);
+}
+
+void parTranspose(struct pool *pool, int M, int N, const int *A, int *B, int tile)
+{
+    struct job job = {M, N, tile, poolThreads(pool), A, NULL, B};
+    poolRun(pool, transWorker, &job);
+}
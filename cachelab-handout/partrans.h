@@ -0,0 +1,45 @@
+/*
+ * partrans.h - Multithreaded tiled transpose for matrices far larger
+ *     than the ones test-trans works on
+ *
+ * A pool of worker threads is created once and reused for every call.
+ * Each thread owns a fixed band of B's rows (A's columns), both when B
+ * is first touched and when it is written, so on a NUMA machine the
+ * pages of B are placed on the node of the thread that writes them.
+ */
+
+#ifndef CACHELAB_PARTRANS_H
+#define CACHELAB_PARTRANS_H
+
+#include <stddef.h>
+
+/* Default tile side, in elements */
+#define PAR_TILE 32
+
+struct pool;
+
+/* poolCreate - Start a pool of threads workers */
+struct pool *poolCreate(int threads);
+
+/* poolThreads - Number of workers in the pool */
+int poolThreads(const struct pool *pool);
+
+/* poolRun - Run fn(arg, id) on every worker and wait for all to finish */
+void poolRun(struct pool *pool, void (*fn)(void *arg, int id), void *arg);
+
+/* poolDestroy - Stop the workers and free the pool */
+void poolDestroy(struct pool *pool);
+
+/*
+ * parFirstTouch - Write A with the test pattern and zero B, each thread
+ *     touching the band of B that parTranspose will have it write
+ */
+void parFirstTouch(struct pool *pool, int M, int N, int *A, int *B, int tile);
+
+/*
+ * parTranspose - B = A^T, where A is N rows of M ints and B is M rows of
+ *     N ints, in tile x tile tiles spread over the pool
+ */
+void parTranspose(struct pool *pool, int M, int N, const int *A, int *B, int tile);
+
+#endif /* CACHELAB_PARTRANS_H */
@@ -0,0 +1,226 @@
+/*
+ * policy.c - Replacement policies for the cache simulator
+ *
+ *  lru      evict the line with the oldest use time
+ *  fifo     evict the line with the oldest fill time
+ *  random   evict a random line, from a per-set xorshift generator
+ *  plru     tree pseudo-LRU, E-1 direction bits per set (E a power of 2)
+ *  bitplru  MRU bit per line, evict the first line with a clear bit
+ *  srrip    2-bit re-reference prediction, insert at distant-1
+ *  brrip    like srrip, but insert at distant except 1 fill in 32
+ */
+#include <string.h>
+#include "policy.h"
+
+#define WORD_BITS (sizeof(unsigned long)*8)
+#define RRPV_MAX 3
+#define BRRIP_LONG 32
+
+const char *policyNames = "lru, fifo, random, plru, bitplru, srrip, brrip";
+
+static int bitWords(int bits)
+{
+    return (bits + WORD_BITS - 1) / WORD_BITS;
+}
+
+static inline int testBit(unsigned long *bits, int i)
+{
+    return (bits[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+static inline void setBit(unsigned long *bits, int i, int v)
+{
+    if (v)
+        bits[i / WORD_BITS] |= 1UL << (i % WORD_BITS);
+    else
+        bits[i / WORD_BITS] &= ~(1UL << (i % WORD_BITS));
+}
+
+/* per-set xorshift64 generator, never zero once seeded */
+static inline unsigned long nextRandom(unsigned long *seed)
+{
+    unsigned long x = *seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *seed = x;
+}
+
+static void seedRandom(unsigned long *seed, int setNum)
+{
+    *seed = 0x9e3779b97f4a7c15UL * (unsigned long)(setNum + 1);
+}
+
+static void noInit(unsigned long *state, int E, int setNum)
+{
+}
+
+static void noTouch(unsigned long *state, int E, int line, unsigned long now)
+{
+}
+
+/* 
+ * lru and fifo - one time stamp per line 
+ */
+static int stampWords(int E)
+{
+    return E;
+}
+
+static void stamp(unsigned long *state, int E, int line, unsigned long now)
+{
+    state[line] = now;
+}
+
+static int oldest(unsigned long *state, int E)
+{
+    int victim = 0;
+    for (int i = 1; i < E; i++) {
+        if (state[i] < state[victim])
+            victim = i;
+    }
+    return victim;
+}
+
+/* 
+ * random - the generator state only
+ */
+static int randomWords(int E)
+{
+    return 1;
+}
+
+static void randomInit(unsigned long *state, int E, int setNum)
+{
+    seedRandom(state, setNum);
+}
+
+static int randomVictim(unsigned long *state, int E)
+{
+    return (int)(nextRandom(state) % E);
+}
+
+/* 
+ * plru - heap ordered tree, node n has children 2n and 2n+1 and line i
+ *     is leaf E+i. A set bit sends the victim search right.
+ */
+static int treeWords(int E)
+{
+    return bitWords(E);
+}
+
+static void treeTouch(unsigned long *state, int E, int line, unsigned long now)
+{
+    for (int node = E + line; node > 1; node /= 2) {
+        /* point the parent away from the child we came from */
+        setBit(state, node / 2, !(node & 1));
+    }
+}
+
+static int treeVictim(unsigned long *state, int E)
+{
+    int node = 1;
+    while (node < E)
+        node = 2 * node + testBit(state, node);
+    return node - E;
+}
+
+/* 
+ * bitplru - one MRU bit per line, cleared for the others once all are set
+ */
+static int mruWords(int E)
+{
+    return bitWords(E);
+}
+
+static void mruTouch(unsigned long *state, int E, int line, unsigned long now)
+{
+    setBit(state, line, 1);
+    for (int w = 0; w < bitWords(E); w++) {
+        unsigned long full = (w == bitWords(E) - 1 && E % WORD_BITS) ?
+            (1UL << (E % WORD_BITS)) - 1 : ~0UL;
+        if (state[w] != full)
+            return;
+    }
+    memset(state, 0, bitWords(E) * sizeof(unsigned long));
+    setBit(state, line, 1);
+}
+
+static int mruVictim(unsigned long *state, int E)
+{
+    for (int w = 0; w < bitWords(E); w++) {
+        if (~state[w]) {
+            int i = w * WORD_BITS + __builtin_ctzl(~state[w]);
+            if (i < E)
+                return i;
+        }
+    }
+    return 0;
+}
+
+/* 
+ * srrip and brrip - one RRPV byte per line, then the generator state
+ */
+static int rripWords(int E)
+{
+    return (E + sizeof(unsigned long) - 1) / sizeof(unsigned long) + 1;
+}
+
+static inline unsigned char *rrpv(unsigned long *state)
+{
+    return (unsigned char *)state;
+}
+
+static void rripInit(unsigned long *state, int E, int setNum)
+{
+    seedRandom(&state[rripWords(E) - 1], setNum);
+}
+
+static void rripTouch(unsigned long *state, int E, int line, unsigned long now)
+{
+    rrpv(state)[line] = 0;
+}
+
+static void srripInsert(unsigned long *state, int E, int line, unsigned long now)
+{
+    rrpv(state)[line] = RRPV_MAX - 1;
+}
+
+static void brripInsert(unsigned long *state, int E, int line, unsigned long now)
+{
+    int longFill = nextRandom(&state[rripWords(E) - 1]) % BRRIP_LONG == 0;
+    rrpv(state)[line] = longFill ? RRPV_MAX - 1 : RRPV_MAX;
+}
+
+static int rripVictim(unsigned long *state, int E)
+{
+    unsigned char *r = rrpv(state);
+    for (;;) {
+        for (int i = 0; i < E; i++) {
+            if (r[i] >= RRPV_MAX)
+                return i;
+        }
+        for (int i = 0; i < E; i++)
+            r[i]++;
+    }
+}
+
+static const struct Policy policies[] = {
+    {"lru", stampWords, noInit, stamp, stamp, oldest},
+    {"fifo", stampWords, noInit, noTouch, stamp, oldest},
+    {"random", randomWords, randomInit, noTouch, noTouch, randomVictim},
+    {"plru", treeWords, noInit, treeTouch, treeTouch, treeVictim},
+    {"bitplru", mruWords, noInit, mruTouch, mruTouch, mruVictim},
+    {"srrip", rripWords, rripInit, rripTouch, srripInsert, rripVictim},
+    {"brrip", rripWords, rripInit, rripTouch, brripInsert, rripVictim},
+};
+
+/* findPolicy - Look up a policy by name, NULL if there is none */
+const struct Policy *findPolicy(const char *name)
+{
+    for (int i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcmp(policies[i].name, name) == 0)
+            return &policies[i];
+    }
+    return NULL;
+}
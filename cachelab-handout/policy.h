@@ -0,0 +1,28 @@
+/*
+ * policy.h - Replacement policies for the cache simulator
+ */
+
+#ifndef CACHELAB_POLICY_H
+#define CACHELAB_POLICY_H
+
+/*
+ * Every set owns stateWords(E) words of policy state, laid out by the
+ * policy and kept next to each other for all sets. Invalid lines are
+ * always filled before a victim is asked for.
+ */
+struct Policy {
+    const char *name;
+    int (*stateWords)(int E);
+    void (*init)(unsigned long *state, int E, int setNum);
+    void (*touch)(unsigned long *state, int E, int line, unsigned long now);
+    void (*insert)(unsigned long *state, int E, int line, unsigned long now);
+    int (*victim)(unsigned long *state, int E);
+};
+
+/* findPolicy - Look up a policy by name, NULL if there is none */
+const struct Policy *findPolicy(const char *name);
+
+/* policyNames - Names of all policies, for usage messages */
+extern const char *policyNames;
+
+#endif /* CACHELAB_POLICY_H */
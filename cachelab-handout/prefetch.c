@@ -0,0 +1,194 @@
+/*
+ * prefetch.c - Hardware prefetchers in front of csim's cache
+ *
+ *  Every demand access trains the enabled prefetchers, which may then
+ *  fill lines ahead of it. Prefetched lines carry a tag in the cache
+ *  until their first demand hit, which makes them useful, or until
+ *  they are evicted unused. Prefetches stay within the 4K page of the
+ *  access that triggered them, like hardware prefetchers do.
+ *  	nextline	on a miss, or the first hit on a prefetched line,
+ *  			fetch the next degree lines (tagged next-line)
+ *  	stride		per 4K region, since traces carry no PC: once the
+ *  			same stride is seen twice in a row, fetch degree
+ *  			strides ahead
+ *  	stream		per 4K region: after misses to three consecutive
+ *  			lines in one direction, stay degree lines ahead
+ *  			of the stream as it is consumed
+ *  Accuracy is useful prefetches over prefetches, coverage is useful
+ *  prefetches over the misses there would have been without them, and
+ *  pollution counts demand misses to lines a prefetch pushed out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prefetch.h"
+
+#define REGION_BITS 12
+#define TABLE_SIZE 256
+#define FILTER_SIZE 4096
+
+enum { NEXT_LINE, STRIDE, STREAM };
+
+struct Prefetcher {
+	int kind;
+	int degree;
+};
+
+/* per-region training state of the stride and stream prefetchers */
+struct Entry {
+	unsigned long region;     /* region number plus one, 0 marks an empty entry */
+	unsigned long last;       /* last address (stride) or line (stream) */
+	long delta;               /* stride in bytes, or stream direction */
+	int confidence;
+};
+
+int prefetchFlag = 0;
+const char *prefetcherNames = "nextline, stride, stream";
+
+static struct Prefetcher prefetchers[MAX_PREFETCHERS];
+static int prefetcherNum = 0;
+static struct Entry strideTable[TABLE_SIZE], streamTable[TABLE_SIZE];
+
+/* lines last evicted by a prefetch, by hash, to spot pollution */
+static unsigned long pollutedLines[FILTER_SIZE];
+static unsigned long pollution = 0;
+
+/* add a prefetcher "name[:degree]", name is one of prefetcherNames */
+void prefetchAdd(char *spec) {
+	static const char *names[] = {"nextline", "stride", "stream"};
+	static const int degrees[] = {1, 2, 4};
+	char name[32];
+	int degree = 0;
+	int n = sscanf(spec, "%31[^:]:%d", name, &degree);
+	if(n < 1 || prefetcherNum == MAX_PREFETCHERS) {
+		printf("Error: Bad prefetcher %s, expected name[:degree] (at most %d)\n", spec, MAX_PREFETCHERS);
+		exit(-1);
+	}
+	for(int k = 0; k < 3; k++) {
+		if(strcmp(name, names[k]) == 0) {
+			prefetchers[prefetcherNum].kind = k;
+			prefetchers[prefetcherNum].degree = n == 2 ? degree : degrees[k];
+			if(prefetchers[prefetcherNum].degree < 1) {
+				printf("Error: Prefetch degree must be at least 1\n");
+				exit(-1);
+			}
+			prefetcherNum++;
+			prefetchFlag = 1;
+			return;
+		}
+	}
+	printf("Error: Unknown prefetcher %s, use one of %s\n", name, prefetcherNames);
+	exit(-1);
+}
+
+/* prefetch the line holding address if it is in the trigger's region */
+static void issue(struct Cache *cache, unsigned long trigger, unsigned long address) {
+	struct Victim victim;
+	if((address >> REGION_BITS) != (trigger >> REGION_BITS)) {
+		return;
+	}
+	if(prefetchFill(cache, address, &victim) && victim.valid && !victim.prefetched) {
+		unsigned long line = victim.address >> cache->b;
+		pollutedLines[line % FILTER_SIZE] = line + 1;
+	}
+}
+
+/* the training entry of address's region, reset if another region held it */
+static struct Entry *entryOf(struct Entry *table, unsigned long address) {
+	unsigned long region = (address >> REGION_BITS) + 1;
+	struct Entry *e = &table[region % TABLE_SIZE];
+	if(e->region != region) {
+		memset(e, 0, sizeof(struct Entry));
+		e->region = region;
+		e->last = ~0UL;
+	}
+	return e;
+}
+
+static void nextLine(struct Cache *cache, struct Prefetcher *p, unsigned long address, int hit) {
+	if(hit && !cache->hitPrefetched) {
+		return;
+	}
+	for(int k = 1; k <= p->degree; k++) {
+		issue(cache, address, ((address >> cache->b) + k) << cache->b);
+	}
+}
+
+static void stride(struct Cache *cache, struct Prefetcher *p, unsigned long address) {
+	struct Entry *e = entryOf(strideTable, address);
+	if(e->last != ~0UL) {
+		long delta = (long)(address - e->last);
+		if(delta != 0 && delta == e->delta) {
+			e->confidence++;
+		}else if(delta != 0) {
+			e->delta = delta;
+			e->confidence = 0;
+		}
+	}
+	e->last = address;
+	if(e->confidence >= 1) {
+		for(int k = 1; k <= p->degree; k++) {
+			issue(cache, address, address + k * e->delta);
+		}
+	}
+}
+
+static void stream(struct Cache *cache, struct Prefetcher *p, unsigned long address, int hit) {
+	struct Entry *e = entryOf(streamTable, address);
+	unsigned long line = address >> cache->b;
+	if(!hit) {
+		long delta = e->last == ~0UL ? 0 : (long)(line - e->last);
+		if((delta == 1 || delta == -1) && delta == e->delta) {
+			e->confidence++;
+		}else {
+			e->delta = delta;
+			e->confidence = (delta == 1 || delta == -1) ? 1 : 0;
+		}
+		e->last = line;
+	}else if(cache->hitPrefetched && e->confidence >= 2) {
+		/* the stream consumed a prefetched line, keep ahead of it */
+		e->last = line;
+	}else {
+		return;
+	}
+	if(e->confidence >= 2) {
+		for(int k = 1; k <= p->degree; k++) {
+			issue(cache, address, (line + k * e->delta) << cache->b);
+		}
+	}
+}
+
+/* train the prefetchers on a demand access to address and issue prefetches into cache */
+void prefetchAccess(struct Cache *cache, unsigned long address, int hit) {
+	if(!hit) {
+		unsigned long line = address >> cache->b;
+		if(pollutedLines[line % FILTER_SIZE] == line + 1) {
+			pollution++;
+			pollutedLines[line % FILTER_SIZE] = 0;
+		}
+	}
+	for(int k = 0; k < prefetcherNum; k++) {
+		struct Prefetcher *p = &prefetchers[k];
+		switch(p->kind) {
+			case NEXT_LINE:
+				nextLine(cache, p, address, hit);
+				break;
+			case STRIDE:
+				stride(cache, p, address);
+				break;
+			case STREAM:
+				stream(cache, p, address, hit);
+				break;
+		}
+	}
+}
+
+/* print accuracy, coverage and pollution of the prefetches into cache */
+void prefetchReport(struct Cache *cache) {
+	unsigned long fills = cache->prefetchFills, useful = cache->prefetchUseful;
+	double accuracy = fills ? (double)useful / fills : 0;
+	double coverage = useful + cache->missCount ? (double)useful / (useful + cache->missCount) : 0;
+	printf("prefetches:%lu evictions:%lu useful:%lu unused:%lu accuracy:%.3f coverage:%.3f pollution:%lu\n",
+		fills, cache->prefetchEvictions, useful, cache->prefetchUnused, accuracy, coverage, pollution);
+}
@@ -0,0 +1,27 @@
+/*
+ * prefetch.h - Hardware prefetchers in front of csim's cache
+ */
+
+#ifndef CACHELAB_PREFETCH_H
+#define CACHELAB_PREFETCH_H
+
+#include "cache.h"
+
+#define MAX_PREFETCHERS 4
+
+/* set by prefetchAdd, the cache is only trained when it is on */
+extern int prefetchFlag;
+
+/* add a prefetcher "name[:degree]", name is one of prefetcherNames */
+void prefetchAdd(char *spec);
+
+/* names of the prefetchers, for error messages */
+extern const char *prefetcherNames;
+
+/* train the prefetchers on a demand access to address and issue prefetches into cache */
+void prefetchAccess(struct Cache *cache, unsigned long address, int hit);
+
+/* print accuracy, coverage and pollution of the prefetches into cache */
+void prefetchReport(struct Cache *cache);
+
+#endif /* CACHELAB_PREFETCH_H */
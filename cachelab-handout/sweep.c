@@ -0,0 +1,121 @@
+/*
+ * sweep.c - Single pass simulation of a grid of LRU cache geometries
+ *
+ *  LRU has the inclusion property: a block at stack distance d in its
+ *  set hits in every cache of that set count with more than d lines.
+ *  So one LRU stack per set, for each (s, b) pair, gives the counts
+ *  of every E at once.
+ *  Stacks are bounded by the largest E, deeper blocks miss anyway.
+ *  hits(E) is the part of the distance histogram below E.
+ *  Evictions are misses minus the fills that found an empty line,
+ *  which is min(distinct blocks, E) for each set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sweep.h"
+
+struct Engine {
+	int s, b;
+	unsigned long *keys;      /* maxE keys per set, most recent first */
+	int *depth;               /* valid keys per set */
+	unsigned long *hist;      /* hits at each stack distance, maxE is a miss */
+};
+
+static struct Engine engines[MAX_SWEEP * MAX_SWEEP];
+static int engineNum = 0, maxE = 0;
+static int *sweepE = NULL, sweepENum = 0;
+
+/* initialize stack distance engines for every (s, b) pair of the grid */
+void sweepInit(int *sList, int sNum, int *EList, int ENum, int *bList, int bNum) {
+	sweepE = EList;
+	sweepENum = ENum;
+	for(int i = 0; i < ENum; i++) {
+		if(EList[i] > maxE) {
+			maxE = EList[i];
+		}
+	}
+	for(int i = 0; i < sNum; i++) {
+		for(int j = 0; j < bNum; j++) {
+			struct Engine *e = &engines[engineNum++];
+			size_t numSets = (size_t)1 << sList[i];
+			e->s = sList[i];
+			e->b = bList[j];
+			e->keys = (unsigned long*)malloc(numSets * maxE * sizeof(unsigned long));
+			e->depth = (int*)calloc(numSets, sizeof(int));
+			e->hist = (unsigned long*)calloc(maxE + 1, sizeof(unsigned long));
+			if(!e->keys || !e->depth || !e->hist) {
+				printf("Error: Cann't allocate cache!\n");
+				exit(-1);
+			}
+		}
+	}
+}
+
+/* move a block to the top of its set's stack and count its stack distance */
+static inline void stackFetch(struct Engine *e, unsigned long key) {
+	size_t setNum = key & (((size_t)1 << e->s)-1);
+	unsigned long *keys = e->keys + setNum * maxE;
+	int depth = e->depth[setNum];
+
+	/* find the stack distance, maxE if not on the stack */
+	int d = 0;
+	while(d < depth && keys[d] != key) {
+		d++;
+	}
+	e->hist[d < depth ? d : maxE]++;
+
+	/* move to the top, dropping the bottom key when the stack is full */
+	if(d == depth) {
+		if(depth < maxE) {
+			e->depth[setNum]++;
+		}else {
+			d = maxE - 1;
+		}
+	}
+	memmove(keys + 1, keys, d * sizeof(unsigned long));
+	keys[0] = key;
+}
+
+/* feed one cache access to every engine, once per block it touches */
+void sweepFetch(unsigned long address, int size) {
+	unsigned long end = address + (size > 1 ? size - 1 : 0);
+	for(int n = 0; n < engineNum; n++) {
+		struct Engine *e = &engines[n];
+		unsigned long key = address >> e->b, last = end >> e->b;
+		stackFetch(e, key);
+		while(key != last) {
+			stackFetch(e, ++key);
+		}
+	}
+}
+
+/* print a summary line for every (s, E, b) of the grid and free engines */
+void sweepReport(void) {
+	for(int n = 0; n < engineNum; n++) {
+		struct Engine *e = &engines[n];
+		size_t numSets = (size_t)1 << e->s;
+		unsigned long total = 0;
+		for(int d = 0; d <= maxE; d++) {
+			total += e->hist[d];
+		}
+		for(int i = 0; i < sweepENum; i++) {
+			int lines = sweepE[i];
+			unsigned long hits = 0, fills = 0;
+			for(int d = 0; d < lines; d++) {
+				hits += e->hist[d];
+			}
+			for(size_t set = 0; set < numSets; set++) {
+				fills += e->depth[set] < lines ? e->depth[set] : lines;
+			}
+			unsigned long misses = total - hits;
+			printf("s:%d E:%d b:%d hits:%lu misses:%lu evictions:%lu\n",
+				e->s, lines, e->b, hits, misses, misses - fills);
+		}
+		free(e->keys);
+		free(e->depth);
+		free(e->hist);
+	}
+	engineNum = 0;
+}
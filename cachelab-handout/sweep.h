@@ -0,0 +1,19 @@
+/*
+ * sweep.h - Single pass simulation of a grid of LRU cache geometries
+ */
+
+#ifndef CACHELAB_SWEEP_H
+#define CACHELAB_SWEEP_H
+
+#define MAX_SWEEP 64
+
+/* initialize stack distance engines for every (s, b) pair of the grid */
+void sweepInit(int *sList, int sNum, int *EList, int ENum, int *bList, int bNum);
+
+/* feed one cache access to every engine, once per block it touches */
+void sweepFetch(unsigned long address, int size);
+
+/* print a summary line for every (s, E, b) of the grid and free engines */
+void sweepReport(void);
+
+#endif /* CACHELAB_SWEEP_H */
@@ -3,6 +3,7 @@
  *     student's transpose functions and records the results for their
  *     official submitted version as well.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -12,6 +13,8 @@
 #include <getopt.h>
 #include <sys/types.h>
 #include "cachelab.h"
+#include "cache.h"
+#include "tracemem.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
 
@@ -32,6 +35,16 @@ extern int func_counter;
 /* Globals set on the command line */
 static int M = 0;
 static int N = 0;
+static int inproc = 0;
+static int jobs = 1;
+
+/* Set in a forked worker, whose signal handlers must stay quiet */
+static int worker = 0;
+
+/* Matrices and cache for the in-process evaluation */
+static int A[MAXN][MAXN];
+static int B[MAXN][MAXN];
+static struct Cache trace_cache;
 
 /* The correctness and performance for the submitted transpose function */
 struct results {
@@ -42,131 +55,351 @@ struct results {
 static struct results results = {-1, 0, INT_MAX};
 
 /* 
- * eval_perf - Evaluate the performance of the registered transpose functions
+ * play_access - Play one access of size bytes on the trace cache: one
+ *     access for L and S, a load and a store for M, on every line the
+ *     bytes touch. Both the valgrind and the -i paths count this way.
  */
-void eval_perf(unsigned int s, unsigned int E, unsigned int b)
+static void play_access(char op, unsigned long addr, int size)
 {
-    int i,flag;
-    unsigned int len, hits, misses, evictions;
-    unsigned long long int marker_start, marker_end, addr;
-    char buf[1000], cmd[255];
-    char filename[128];
+    unsigned long line, last = (addr + (size > 1 ? size - 1 : 0)) >> trace_cache.b;
+    for (line = addr >> trace_cache.b; line <= last; line++) {
+        if (!probe(&trace_cache, line << trace_cache.b, op == 'S'))
+            fill(&trace_cache, line << trace_cache.b, op == 'S');
+        if (op == 'M' && !probe(&trace_cache, line << trace_cache.b, 1))
+            fill(&trace_cache, line << trace_cache.b, 1);
+    }
+}
 
-    registerFunctions(); 
+/* The outcome of tracing one function */
+struct eval {
+    int status;    /* tracegen's exit status, 0 if the transpose was right */
+    unsigned int hits, misses, evictions;   /* from csim-ref */
+    unsigned int line_misses;   /* misses counting every line an access touches */
+};
+
+/* 
+ * trace_one - Run function i under valgrind and score its trace with
+ *     csim-ref
+ *
+ * valgrind's output is read through a pipe as it runs, so the full
+ * trace never goes to disk. The accesses between the markers are
+ * filtered on the fly into trace.f<i>, which csim-ref then scores, and
+ * the addresses of A and B go to trace.f<i>.bases, for heatmap. csim-ref
+ * counts an access once, in the line of its first byte; the accesses
+ * are also played into the cache model by size, as -i counts them, so
+ * a line-crossing kernel can be told apart. The pipe and the files
+ * belong to this function alone, so several can be traced at once.
+ */
+static void trace_one(int i, unsigned int s, unsigned int E, unsigned int b,
+                      struct eval *ev)
+{
+    int flag,markers;
+    unsigned int len;
+    unsigned long long int marker_start, marker_end, addr, base_a, base_b;
+    char buf[1000], cmd[255];
+    char filename[128], basesname[160];
+    FILE* bases_fp;
+    FILE* ref_fp;
 
-    /* Open the complete trace file */
+    /* The valgrind pipe and the filtered trace */
     FILE* full_trace_fp;  
     FILE* part_trace_fp; 
 
-    /* Evaluate the performance of each registered transpose function */
+    /* Use valgrind to generate the trace */
+    sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d -S", M, N,i);
+    full_trace_fp = popen(cmd, "r");
+    assert(full_trace_fp);
+
+    /* Filtered trace for each transpose function goes in a separate file */
+    sprintf(filename, "trace.f%d", i);
+    sprintf(basesname, "%s.bases", filename);
+    part_trace_fp = fopen(filename, "w");
+    assert(part_trace_fp);
+    remove(basesname);
+    initialCache(&trace_cache, s, E, b, findPolicy("lru"));
+
+    /* Locate trace corresponding to the trans function */
+    flag = 0;
+    markers = 0;
+    marker_start = marker_end = 0;
+    while (fgets(buf, 1000, full_trace_fp) != NULL) {
+
+        /* tracegen prints the marker addresses, then those of A and B,
+           before it runs the function */
+        if (!markers && strncmp(buf, "MARKERS ", 8) == 0) {
+            int n = sscanf(buf+8, "%llx %llx %llx %llx",
+                           &marker_start, &marker_end, &base_a, &base_b);
+            markers = n >= 2;
+            if (n == 4) {
+                bases_fp = fopen(basesname, "w");
+                assert(bases_fp);
+                fprintf(bases_fp, "%llx %llx\n", base_a, base_b);
+                fclose(bases_fp);
+            }
+            continue;
+        }
+
+        /* We are only interested in memory access instructions,
+           and after the end marker only in draining the pipe */
+        if (markers && part_trace_fp && buf[0]==' ' && buf[2]==' ' &&
+            (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
+            sscanf(buf+3, "%llx,%u", &addr, &len);
+    
+            /* If start marker found, set flag */
+            if (addr == marker_start)
+                flag = 1;
+
+            /* Valgrind creates many spurious accesses to the
+               stack that have nothing to do with the students
+               code. At the moment, we are ignoring all stack
+               accesses by using the simple filter of recording
+               accesses to only the low 32-bit portion of the
+               address space. At some point it would be nice to
+               try to do more informed filtering so that would
+               eliminate the valgrind stack references while
+               include the student stack references. */
+            if (flag && addr < 0xffffffff) {
+                fputs(buf, part_trace_fp);
+                play_access(buf[1], addr, len);
+            }
+
+            /* if end marker found, close trace file */
+            if (addr == marker_end) {
+                flag = 0;
+                fclose(part_trace_fp);
+                part_trace_fp = NULL;
+            }
+        }
+    }
+    if (part_trace_fp)
+        fclose(part_trace_fp);
+
+    /* tracegen's exit status says whether the transpose was correct */
+    ev->status = WEXITSTATUS(pclose(full_trace_fp));
+    if (ev->status == 0 && !markers)
+        ev->status = -1;
+    ev->line_misses = trace_cache.missCount;
+    freeCache(&trace_cache);
+
+    /* Run the reference simulator, reading its summary from its output
+       rather than .csim_results, which concurrent runs would share */
+    if (ev->status == 0) {
+        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t %s", s, E, b, filename);
+        ref_fp = popen(cmd, "r");
+        assert(ref_fp);
+        ev->status = -1;
+        while (fgets(buf, 1000, ref_fp) != NULL)
+            if (sscanf(buf, "hits:%u misses:%u evictions:%u",
+                       &ev->hits, &ev->misses, &ev->evictions) == 3)
+                ev->status = 0;
+        if (pclose(ref_fp) != 0)
+            ev->status = -1;
+    }
+    if (ev->status != 0) {
+        remove(filename);
+        remove(basesname);
+    }
+}
+
+/* 
+ * report_one - Print the outcome of tracing function i and record it
+ *     in func_list and results
+ */
+static void report_one(int i, unsigned int s, unsigned int E, unsigned int b,
+                       const struct eval *ev)
+{
+    if (ev->status < 0) {
+        printf("Error: Cann't trace function %d!\nSkipping performance evaluation for this function.\n", i);
+        return;
+    }
+    if (0!=ev->status) {
+        printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",ev->status-1,M,N,i);      
+        return;
+    }
+
+    func_list[i].correct=1;
+
+    /* Save the correctness of the transpose submission */
+    if (results.funcid == i ) {
+        results.correct = 1;
+    }
+
+    /* Collect the results from the cache model */
+    printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
+    func_list[i].num_hits = ev->hits;
+    func_list[i].num_misses = ev->misses;
+    func_list[i].num_evictions = ev->evictions;
+    printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
+           i, func_list[i].description, ev->hits, ev->misses, ev->evictions);
+    if (ev->line_misses != ev->misses)
+        printf("Note: some accesses cross a line; counting every line they touch, as -i does, gives misses:%u\n",
+               ev->line_misses);
+
+    /* If it is transpose_submit(), record number of misses */
+    if (results.funcid == i) {
+        results.misses = ev->misses;
+    }
+}
+
+/* 
+ * eval_perf - Evaluate the performance of the registered transpose functions
+ *
+ * With -j, each function is traced in a worker process that leaves its
+ * counts in .results.f<i>, written to a temporary file and renamed so a
+ * worker that dies never leaves a partial one. Up to jobs workers run at
+ * once, and the parent reports the functions in order once all are done;
+ * a worker that does not exit cleanly marks its function invalid.
+ */
+void eval_perf(unsigned int s, unsigned int E, unsigned int b)
+{
+    int i, next, running, status;
+    struct eval ev;
+    char filename[128], tmpname[160];
+    int failed[MAX_TRANS_FUNCS];
+    pid_t pids[MAX_TRANS_FUNCS];
+    FILE *fp;
+    pid_t pid;
+
+    registerFunctions(); 
 
     for (i=0; i<func_counter; i++) {
         if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
             results.funcid = i; /* remember which function is the submission */
+    }
 
-
-        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
-        /* Use valgrind to generate the trace */
-
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N,i);
-        flag=WEXITSTATUS(system(cmd));
-        if (0!=flag) {
-            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
-            continue;
+    /* Evaluate the performance of each registered transpose function */
+    if (jobs <= 1) {
+        for (i=0; i<func_counter; i++) {
+            printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
+            fflush(stdout);
+            trace_one(i, s, E, b, &ev);
+            report_one(i, s, E, b, &ev);
         }
+        return;
+    }
 
-        /* Get the start and end marker addresses */
-        FILE* marker_fp = fopen(".marker", "r");
-        assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
-        fclose(marker_fp);
+    /* Keep up to jobs workers busy */
+    fflush(stdout);
+    next = running = 0;
+    while (next < func_counter || running > 0) {
+        if (running < jobs && next < func_counter) {
+            sprintf(filename, ".results.f%d", next);
+            remove(filename);
+            failed[next] = 0;
+            pid = fork();
+            assert(pid >= 0);
+            if (pid == 0) {
+                worker = 1;
+                trace_one(next, s, E, b, &ev);
+                sprintf(tmpname, "%s.tmp", filename);
+                fp = fopen(tmpname, "w");
+                if (!fp)
+                    _exit(1);
+                fprintf(fp, "%d %u %u %u %u\n", ev.status, ev.hits, ev.misses, ev.evictions,
+                        ev.line_misses);
+                if (fclose(fp) != 0 || rename(tmpname, filename) != 0)
+                    _exit(1);
+                _exit(0);
+            }
+            pids[next] = pid;
+            running++;
+            next++;
+        } else if ((pid = wait(&status)) > 0) {
+            running--;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+                continue;
+            for (i=0; i<next; i++)
+                if (pids[i] == pid)
+                    failed[i] = 1;
+        }
+    }
 
+    for (i=0; i<func_counter; i++) {
+        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
+        sprintf(filename, ".results.f%d", i);
+        fp = failed[i] ? NULL : fopen(filename, "r");
+        if (!fp || fscanf(fp, "%d %u %u %u %u", &ev.status, &ev.hits, &ev.misses,
+                          &ev.evictions, &ev.line_misses) != 5)
+            ev.status = -1;   /* the worker died */
+        if (fp)
+            fclose(fp);
+        remove(filename);
+        report_one(i, s, E, b, &ev);
+    }
+}
 
-        func_list[i].correct=1;
+/*
+ * record_access - Feed accesses to A and B into the cache model. Like
+ *     the valgrind filter, this leaves out the function's stack.
+ */
+static void record_access(char op, unsigned long addr, int size)
+{
+    unsigned long a = (unsigned long)A, b = (unsigned long)B;
+    if ((addr - a < sizeof(A)) || (addr - b < sizeof(B)))
+        play_access(op, addr, size);
+}
 
-        /* Save the correctness of the transpose submission */
-        if (results.funcid == i ) {
-            results.correct = 1;
-        }
+/* 
+ * eval_perf_inproc - Evaluate the registered transpose functions
+ *     in-process. trans.c is instrumented at compile time, so every
+ *     load and store of A and B goes straight into the cache model
+ *     instead of through valgrind, a trace file and csim-ref.
+ */
+void eval_perf_inproc(unsigned int s, unsigned int E, unsigned int b)
+{
+    int i, r, c;
 
-        full_trace_fp = fopen("trace.tmp", "r");
-        assert(full_trace_fp);
+    registerFunctions();
 
+    for (i=0; i<func_counter; i++) {
+        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
+            results.funcid = i; /* remember which function is the submission */
 
-        /* Filtered trace for each transpose function goes in a separate file */
-        sprintf(filename, "trace.f%d", i);
-        part_trace_fp = fopen(filename, "w");
-        assert(part_trace_fp);
-    
-        /* Locate trace corresponding to the trans function */
-        flag = 0;
-        while (fgets(buf, 1000, full_trace_fp) != NULL) {
-
-            /* We are only interested in memory access instructions */
-            if (buf[0]==' ' && buf[2]==' ' &&
-                (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
-                sscanf(buf+3, "%llx,%u", &addr, &len);
-        
-                /* If start marker found, set flag */
-                if (addr == marker_start)
-                    flag = 1;
-
-                /* Valgrind creates many spurious accesses to the
-                   stack that have nothing to do with the students
-                   code. At the moment, we are ignoring all stack
-                   accesses by using the simple filter of recording
-                   accesses to only the low 32-bit portion of the
-                   address space. At some point it would be nice to
-                   try to do more informed filtering so that would
-                   eliminate the valgrind stack references while
-                   include the student stack references. */
-                if (flag && addr < 0xffffffff) {
-                    fputs(buf, part_trace_fp);
-                }
-
-                /* if end marker found, close trace file */
-                if (addr == marker_end) {
-                    flag = 0;
-                    fclose(part_trace_fp);
-                    break;
-                }
-            }
+        printf("\nFunction %d (%d total)\nStep 1: Validating and tracing in-process\n",i,func_counter);
+        initMatrix(M, N, A, B);
+        initialCache(&trace_cache, s, E, b, findPolicy("lru"));
+        traceMemStart(record_access);
+        (*func_list[i].func_ptr)(M, N, A, B);
+        traceMemStop();
+
+        /* Check B against A before trusting the counts */
+        func_list[i].correct = 1;
+        for (r = 0; r < N; r++)
+            for (c = 0; c < M; c++)
+                if (((int (*)[M])A)[r][c] != ((int (*)[N])B)[c][r])
+                    func_list[i].correct = 0;
+        if (!func_list[i].correct) {
+            printf("Validation error at function %d!\nSkipping performance evaluation for this function.\n", i);
+            freeCache(&trace_cache);
+            continue;
         }
-        fclose(full_trace_fp);
+        if (results.funcid == i)
+            results.correct = 1;
 
-        /* Run the reference simulator */
         printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null", 
-                s, E, b, i);
-        system(cmd);
-    
-        /* Collect results from the reference simulator */
-        FILE* in_fp = fopen(".csim_results","r");
-        assert(in_fp);
-        fscanf(in_fp, "%u %u %u", &hits, &misses, &evictions);
-        fclose(in_fp);
-        func_list[i].num_hits = hits;
-        func_list[i].num_misses = misses;
-        func_list[i].num_evictions = evictions;
+        func_list[i].num_hits = trace_cache.hitCount;
+        func_list[i].num_misses = trace_cache.missCount;
+        func_list[i].num_evictions = trace_cache.evictCount;
+        freeCache(&trace_cache);
         printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
-               i, func_list[i].description, hits, misses, evictions);
-    
+               i, func_list[i].description, func_list[i].num_hits,
+               func_list[i].num_misses, func_list[i].num_evictions);
+
         /* If it is transpose_submit(), record number of misses */
-        if (results.funcid == i) {
-            results.misses = misses;
-        }
+        if (results.funcid == i)
+            results.misses = func_list[i].num_misses;
     }
-  
 }
 
 /*
  * usage - Print usage info
  */
 void usage(char *argv[]){
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-hi] [-j <jobs>] -M <rows> -N <cols>\n", argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
+    printf("  -i          Trace in-process instead of with valgrind.\n");
+    printf("  -j <jobs>   Trace up to this many functions at once (default 1)\n");
     printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
     printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
     printf("Example: %s -M 8 -N 8\n", argv[0]);       
@@ -176,6 +409,8 @@ void usage(char *argv[]){
  * sigsegv_handler - SIGSEGV handler
  */
 void sigsegv_handler(int signum){
+    if (worker)
+        _exit(2);   /* the parent marks the function invalid */
     printf("Error: Segmentation Fault.\n");
     printf("TEST_TRANS_RESULTS=0:0\n");
     fflush(stdout);
@@ -186,6 +421,8 @@ void sigsegv_handler(int signum){
  * sigalrm_handler - SIGALRM handler
  */
 void sigalrm_handler(int signum){
+    if (worker)
+        _exit(2);
     printf("Error: Program timed out.\n");
     printf("TEST_TRANS_RESULTS=0:0\n");
     fflush(stdout);
@@ -199,7 +436,7 @@ int main(int argc, char* argv[])
 {
     char c;
 
-    while ((c = getopt(argc,argv,"M:N:h")) != -1) {
+    while ((c = getopt(argc,argv,"M:N:hij:")) != -1) {
         switch(c) {
         case 'M':
             M = atoi(optarg);
@@ -207,6 +444,12 @@ int main(int argc, char* argv[])
         case 'N':
             N = atoi(optarg);
             break;
+        case 'i':
+            inproc = 1;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            break;
         case 'h':
             usage(argv);
             exit(0);
@@ -243,7 +486,10 @@ int main(int argc, char* argv[])
     alarm(120);
 
     /* Check the performance of the student's transpose function */
-    eval_perf(5, 1, 5);
+    if (inproc)
+        eval_perf_inproc(5, 1, 5);
+    else
+        eval_perf(5, 1, 5);
   
     /* Emit the results for this particular test */
     if (results.funcid == -1) {
@@ -0,0 +1,72 @@
+/*
+ * trace2bin.c - Convert a valgrind/lackey text trace into the binary
+ *     trace format that csim can map and replay without parsing.
+ *
+ * Usage: ./trace2bin <text trace> <binary trace>
+ *
+ * Lines that are not memory accesses (valgrind's own "==pid==" output,
+ * for example) are skipped, so both the filtered trace.f* files and
+ * raw lackey output can be converted.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bintrace.h"
+
+/* 
+ * parseAccess - Parse " L 7ff000398,8" style lines. Returns 1 if the
+ *     line is a memory access.
+ */
+static int parseAccess(const char *buf, char *op, unsigned long long *addr, int *size)
+{
+    char *end;
+    while (*buf == ' ')
+        buf++;
+    if (!strchr("LSMI", *buf) || *buf == '\0' || buf[1] != ' ')
+        return 0;
+    *op = *buf++;
+    while (*buf == ' ')
+        buf++;
+    *addr = strtoull(buf, &end, 16);
+    if (end == buf || *end != ',')
+        return 0;
+    *size = (int)strtol(end + 1, NULL, 10);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    char buf[1000];
+    char op;
+    unsigned long long addr;
+    int size;
+    struct binTraceWriter w;
+
+    if (argc != 3) {
+        printf("Usage: %s <text trace> <binary trace>\n", argv[0]);
+        exit(1);
+    }
+
+    FILE *in_fp = fopen(argv[1], "r");
+    if (!in_fp) {
+        printf("Error: Cann't open file %s!\n", argv[1]);
+        exit(1);
+    }
+    if (binTraceWriterOpen(&w, argv[2]) < 0) {
+        printf("Error: Cann't create file %s!\n", argv[2]);
+        exit(1);
+    }
+
+    while (fgets(buf, sizeof(buf), in_fp) != NULL) {
+        if (parseAccess(buf, &op, &addr, &size))
+            binTraceWrite(&w, op, addr, size);
+    }
+    fclose(in_fp);
+
+    if (binTraceWriterClose(&w) < 0) {
+        printf("Error: Cann't write file %s!\n", argv[2]);
+        exit(1);
+    }
+    printf("%llu accesses written to %s\n", w.count, argv[2]);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * tracecap.c - Capture the accesses seen by tracemem to a binary trace
+ *
+ * The ring has one producer, the tracing hook on the traced thread, and
+ * one consumer, the writer thread. Each side owns one index and only
+ * reads the other's, so acquire/release ordering on the two indices is
+ * all the synchronisation there is: the producer publishes a record by
+ * releasing head after filling it, the consumer frees a batch of slots
+ * by releasing tail after encoding them. Either side yields the CPU
+ * while the ring is full or empty.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include "bintrace.h"
+#include "tracemem.h"
+#include "tracecap.h"
+
+/* One captured access */
+struct record {
+    unsigned long addr;
+    int size;
+    char op;
+};
+
+static struct record ring[TRACECAP_RING];
+static unsigned long head;      /* next slot to fill, written by the producer */
+static unsigned long tail;      /* next slot to drain, written by the consumer */
+static int stopping;            /* set once the producer is done */
+
+/* Address windows to keep, none means keep everything */
+static unsigned long windowBase[TRACECAP_WINDOWS], windowSize[TRACECAP_WINDOWS];
+static int windows;
+
+static struct binTraceWriter writer;
+static pthread_t writerThread;
+
+/* capture - The tracing hook: append one access to the ring */
+static void capture(char op, unsigned long addr, int size)
+{
+    unsigned long h = head;
+    int i;
+    for (i = 0; i < windows; i++)
+        if (addr - windowBase[i] < windowSize[i])
+            break;
+    if (windows && i == windows)
+        return;
+    while (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == TRACECAP_RING)
+        sched_yield();
+    struct record *r = &ring[h & (TRACECAP_RING - 1)];
+    r->addr = addr;
+    r->size = size;
+    r->op = op;
+    __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+}
+
+/* drain - The writer thread: encode records until stopped and empty */
+static void *drain(void *arg)
+{
+    unsigned long t = tail;
+    for (;;) {
+        int done = __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+        unsigned long h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        if (h == t) {
+            if (done)
+                break;
+            sched_yield();
+            continue;
+        }
+        for (; t != h; t++) {
+            struct record *r = &ring[t & (TRACECAP_RING - 1)];
+            binTraceWrite(&writer, r->op, r->addr, r->size);
+        }
+        __atomic_store_n(&tail, t, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/*
+ * traceCapKeep - Capture only accesses that start in [base, base+size)
+ *     or in another window added this way. Without windows every
+ *     access is captured. Returns -1 if all windows are taken.
+ */
+int traceCapKeep(unsigned long base, unsigned long size)
+{
+    if (windows == TRACECAP_WINDOWS)
+        return -1;
+    windowBase[windows] = base;
+    windowSize[windows] = size;
+    windows++;
+    return 0;
+}
+
+/*
+ * traceCapStart - Create a binary trace at path and start capturing
+ *     every instrumented access into it. Returns 0 on success, -1 if
+ *     the file or the writer thread cannot be created.
+ */
+int traceCapStart(const char *path)
+{
+    if (binTraceWriterOpen(&writer, path) < 0)
+        return -1;
+    head = tail = 0;
+    stopping = 0;
+    if (pthread_create(&writerThread, NULL, drain, NULL) != 0) {
+        binTraceWriterClose(&writer);
+        return -1;
+    }
+    traceMemStart(capture);
+    return 0;
+}
+
+/*
+ * traceCapStop - Stop capturing, wait for the writer to drain the ring
+ *     and close the trace. Returns the number of accesses captured, or
+ *     -1 if the trace could not be written.
+ */
+long long traceCapStop(void)
+{
+    traceMemStop();
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(writerThread, NULL);
+    long long count = (long long)writer.count;
+    if (binTraceWriterClose(&writer) < 0)
+        return -1;
+    return count;
+}
@@ -0,0 +1,41 @@
+/*
+ * tracecap.h - Capture the accesses seen by tracemem to a binary trace
+ *
+ * The tracing hook only pushes each access into a single-producer,
+ * single-consumer lock-free ring buffer. A background thread drains the
+ * ring and writes the accesses in the delta-compressed format of
+ * bintrace.h, which csim replays directly, so the traced code never
+ * waits on formatting or the disk unless the ring fills up.
+ */
+
+#ifndef CACHELAB_TRACECAP_H
+#define CACHELAB_TRACECAP_H
+
+/* Records in the ring, a power of two */
+#define TRACECAP_RING (1 << 16)
+
+/* Address windows traceCapKeep can hold */
+#define TRACECAP_WINDOWS 4
+
+/*
+ * traceCapKeep - Capture only accesses that start in [base, base+size)
+ *     or in another window added this way. Without windows every
+ *     access is captured. Returns -1 if all windows are taken.
+ */
+int traceCapKeep(unsigned long base, unsigned long size);
+
+/*
+ * traceCapStart - Create a binary trace at path and start capturing
+ *     every instrumented access into it. Returns 0 on success, -1 if
+ *     the file or the writer thread cannot be created.
+ */
+int traceCapStart(const char *path);
+
+/*
+ * traceCapStop - Stop capturing, wait for the writer to drain the ring
+ *     and close the trace. Returns the number of accesses captured, or
+ *     -1 if the trace could not be written.
+ */
+long long traceCapStop(void);
+
+#endif /* CACHELAB_TRACECAP_H */
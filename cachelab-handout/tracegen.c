@@ -4,7 +4,17 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses are recorded in file for later use. With -S they are
+ * printed as "MARKERS start end A B" on stdout instead, along with the
+ * addresses of the matrices, before any function runs, so a reader of
+ * valgrind's output on a pipe learns them in time and concurrent runs
+ * do not share the .marker file.
+ *
+ * Built as tracegen-cap (against the instrumented trans-inst.o, with
+ * TRACE_CAPTURE defined) it traces itself instead: -C prefix captures
+ * each function's accesses to A and B in-process to the binary trace
+ * prefix.f<i>, which csim replays directly, with no valgrind involved.
+ * Like the valgrind filter in test-trans, the stack is left out.
  */
 
 #include <stdlib.h>
@@ -14,6 +24,9 @@
 #include <getopt.h>
 #include "cachelab.h"
 #include <string.h>
+#ifdef TRACE_CAPTURE
+#include "tracecap.h"
+#endif
 
 /* External variables declared in cachelab.c */
 extern trans_func_t func_list[MAX_TRANS_FUNCS];
@@ -46,12 +59,44 @@ int validate(int fn,int M, int N, int A[N][M], int B[M][N]) {
     return 1;
 }
 
+#ifdef TRACE_CAPTURE
+static char *capturePrefix = NULL;
+#define OPTSTRING "M:N:F:SC:"
+#else
+#define OPTSTRING "M:N:F:S"
+#endif
+
+/* Run function i on A and B between the markers, capturing it with -C */
+static void run(int i)
+{
+#ifdef TRACE_CAPTURE
+    char path[1024];
+    if (capturePrefix) {
+        snprintf(path, sizeof(path), "%s.f%d", capturePrefix, i);
+        if (traceCapStart(path) < 0) {
+            printf("Error: Cann't capture to %s!\n", path);
+            exit(-1);
+        }
+    }
+#endif
+    MARKER_START = 33;
+    (*func_list[i].func_ptr)(M, N, A, B);
+    MARKER_END = 34;
+#ifdef TRACE_CAPTURE
+    if (capturePrefix && traceCapStop() < 0) {
+        printf("Error: Cann't write %s!\n", path);
+        exit(-1);
+    }
+#endif
+}
+
 int main(int argc, char* argv[]){
     int i;
 
     char c;
     int selectedFunc=-1;
-    while( (c=getopt(argc,argv,"M:N:F:")) != -1){
+    int streamMarkers=0;
+    while( (c=getopt(argc,argv,OPTSTRING)) != -1){
         switch(c){
         case 'M':
             M = atoi(optarg);
@@ -62,6 +107,14 @@ int main(int argc, char* argv[]){
         case 'F':
             selectedFunc = atoi(optarg);
             break;
+        case 'S':
+            streamMarkers = 1;
+            break;
+#ifdef TRACE_CAPTURE
+        case 'C':
+            capturePrefix = optarg;
+            break;
+#endif
         case '?':
         default:
             printf("./tracegen failed to parse its options.\n");
@@ -73,30 +126,40 @@ int main(int argc, char* argv[]){
     /*  Register transpose functions */
     registerFunctions();
 
+#ifdef TRACE_CAPTURE
+    traceCapKeep((unsigned long)A, sizeof(A));
+    traceCapKeep((unsigned long)B, sizeof(B));
+#endif
+
     /* Fill A with data */
     initMatrix(M,N, A, B); 
 
     /* Record marker addresses */
-    FILE* marker_fp = fopen(".marker","w");
-    assert(marker_fp);
-    fprintf(marker_fp, "%llx %llx", 
-            (unsigned long long int) &MARKER_START,
-            (unsigned long long int) &MARKER_END );
-    fclose(marker_fp);
+    if (streamMarkers) {
+        printf("MARKERS %llx %llx %llx %llx\n",
+               (unsigned long long int) &MARKER_START,
+               (unsigned long long int) &MARKER_END,
+               (unsigned long long int) A,
+               (unsigned long long int) B );
+        fflush(stdout);
+    } else {
+        FILE* marker_fp = fopen(".marker","w");
+        assert(marker_fp);
+        fprintf(marker_fp, "%llx %llx", 
+                (unsigned long long int) &MARKER_START,
+                (unsigned long long int) &MARKER_END );
+        fclose(marker_fp);
+    }
 
     if (-1==selectedFunc) {
         /* Invoke registered transpose functions */
         for (i=0; i < func_counter; i++) {
-            MARKER_START = 33;
-            (*func_list[i].func_ptr)(M, N, A, B);
-            MARKER_END = 34;
+            run(i);
             if (!validate(i,M,N,A,B))
                 return i+1;
         }
     } else {
-        MARKER_START = 33;
-        (*func_list[selectedFunc].func_ptr)(M, N, A, B);
-        MARKER_END = 34;
+        run(selectedFunc);
         if (!validate(selectedFunc,M,N,A,B))
             return selectedFunc+1;
 
@@ -0,0 +1,69 @@
+/*
+ * tracemem.c - In-process memory tracing of the transpose functions
+ *
+ * These are the hooks gcc's -fsanitize=thread instrumentation calls.
+ * Only the plain and unaligned access hooks do any work; the others
+ * exist so instrumented objects link without the sanitizer runtime.
+ */
+#include <stddef.h>
+#include "tracemem.h"
+
+static tracemem_fn traceFn = NULL;
+
+/* traceMemStart - Pass every instrumented access to fn until traceMemStop */
+void traceMemStart(tracemem_fn fn)
+{
+    traceFn = fn;
+}
+
+/* traceMemStop - Stop passing accesses on */
+void traceMemStop(void)
+{
+    traceFn = NULL;
+}
+
+static inline void traceAccess(char op, void *addr, int size)
+{
+    if (traceFn)
+        traceFn(op, (unsigned long)addr, size);
+}
+
+#define TRACE_HOOKS(N)                                                   \
+    void __tsan_read##N(void *addr) { traceAccess('L', addr, N); }      \
+    void __tsan_write##N(void *addr) { traceAccess('S', addr, N); }     \
+    void __tsan_unaligned_read##N(void *addr) { traceAccess('L', addr, N); } \
+    void __tsan_unaligned_write##N(void *addr) { traceAccess('S', addr, N); }
+
+/* The prototypes keep -Wmissing-prototypes builds quiet */
+#define TRACE_PROTOS(N)                                                  \
+    void __tsan_read##N(void *addr);                                     \
+    void __tsan_write##N(void *addr);                                    \
+    void __tsan_unaligned_read##N(void *addr);                           \
+    void __tsan_unaligned_write##N(void *addr);
+
+TRACE_PROTOS(1)
+TRACE_PROTOS(2)
+TRACE_PROTOS(4)
+TRACE_PROTOS(8)
+TRACE_PROTOS(16)
+TRACE_HOOKS(1)
+TRACE_HOOKS(2)
+TRACE_HOOKS(4)
+TRACE_HOOKS(8)
+TRACE_HOOKS(16)
+
+void __tsan_read_range(void *addr, size_t size);
+void __tsan_write_range(void *addr, size_t size);
+void __tsan_init(void);
+void __tsan_func_entry(void *pc);
+void __tsan_func_exit(void);
+void __tsan_vptr_read(void **vptr);
+void __tsan_vptr_update(void **vptr, void *value);
+
+void __tsan_read_range(void *addr, size_t size) { traceAccess('L', addr, (int)size); }
+void __tsan_write_range(void *addr, size_t size) { traceAccess('S', addr, (int)size); }
+void __tsan_init(void) {}
+void __tsan_func_entry(void *pc) {}
+void __tsan_func_exit(void) {}
+void __tsan_vptr_read(void **vptr) {}
+void __tsan_vptr_update(void **vptr, void *value) {}
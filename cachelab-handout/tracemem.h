@@ -0,0 +1,23 @@
+/*
+ * tracemem.h - In-process memory tracing of the transpose functions
+ *
+ * trans.c is compiled a second time with -fsanitize=thread, which makes
+ * gcc call a __tsan_readN/__tsan_writeN hook before every load and
+ * store. tracemem.c supplies those hooks in place of the ThreadSanitizer
+ * runtime and hands each access to a callback while tracing is on, so
+ * a transpose function can be traced without valgrind.
+ */
+
+#ifndef CACHELAB_TRACEMEM_H
+#define CACHELAB_TRACEMEM_H
+
+/* Called with 'L' or 'S', the address and the size of every access */
+typedef void (*tracemem_fn)(char op, unsigned long addr, int size);
+
+/* traceMemStart - Pass every instrumented access to fn until traceMemStop */
+void traceMemStart(tracemem_fn fn);
+
+/* traceMemStop - Stop passing accesses on */
+void traceMemStop(void);
+
+#endif /* CACHELAB_TRACEMEM_H */
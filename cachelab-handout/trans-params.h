@@ -0,0 +1,37 @@
+/*
+ * trans-params.h - Parameters of the blocked transpose in trans.c, and
+ *     the tuning knobs autotune and trans-tuned.h need. Handed in with
+ *     trans.c, so the stock cachelab.h is enough to build it.
+ */
+
+#ifndef CACHELAB_TRANS_PARAMS_H
+#define CACHELAB_TRANS_PARAMS_H
+
+/* 
+ * trans_params - Parameters of the blocked transpose. A and B are walked
+ *     in tile_rows x tile_cols tiles of A, tile by tile along the rows of
+ *     A (order 0) or down its columns (order 1). diag says how elements
+ *     on the diagonal are handled, since A[i][i] and B[i][i] can map to
+ *     the same set: in order (none), after the rest of the tile row
+ *     (defer), or with the row read 8 elements at a time into scalar
+ *     locals before writing B (locals). TRANS_MAX_TILE is the largest
+ *     tile side autotune tries.
+ */
+#define TRANS_MAX_TILE 32
+enum { DIAG_NONE, DIAG_DEFER, DIAG_LOCALS };
+
+struct trans_params {
+    int M, N;
+    int tile_rows, tile_cols;
+    int order;
+    int diag;
+};
+
+/* Blocked transpose driven by a parameter set */
+void transpose_blocked(int M, int N, int A[N][M], int B[M][N],
+                       const struct trans_params *p);
+
+/* Base case size of transpose_recursive, 8 by default */
+extern int recursive_base;
+
+#endif /* CACHELAB_TRANS_PARAMS_H */
@@ -0,0 +1,14 @@
+/*
+ * trans-tuned.h - Blocked transpose parameters picked by autotune for
+ *     s=5, E=1, b=5. Regenerate with
+ *     ./autotune -S 32x32,64x64,61x67 -s 5 -E 1 -b 5 -o trans-tuned.h
+ */
+
+#include "trans-params.h"
+
+/* {M, N, tile_rows, tile_cols, order, diag} */
+static const struct trans_params tuned_params[] = {
+    {32, 32, 32, 8, 0, DIAG_DEFER},
+    {64, 64, 32, 4, 0, DIAG_DEFER},
+    {61, 67, 32, 16, 1, DIAG_LOCALS},
+};
@@ -13,7 +13,13 @@
 
 #include <stdio.h>
 #include "cachelab.h"
+#include "trans-params.h"
 #include "contracts.h"
+#include "trans-tuned.h"
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_SIMD_TRANS
+#endif
 
 int is_transpose(int M, int N, int A[N][M], int B[M][N]);
 
@@ -151,6 +157,244 @@ void trans(int M, int N, int A[N][M], int B[M][N])
     ENSURES(is_transpose(M, N, A, B));
 }
 
+/* 
+ * blocked_tile - Transpose the tile of A at (row, col) as p says. With
+ *     DIAG_LOCALS each tile row is read 8 elements at a time into
+ *     scalar locals before any of them is written to B, and the columns
+ *     left over past the last group of 8 are done as with DIAG_DEFER.
+ *     There are no local arrays and at most 12 int locals.
+ */
+static void blocked_tile(int M, int N, int A[N][M], int B[M][N],
+                         const struct trans_params *p, int row, int col)
+{
+    int i, j, t0, t1, t2, t3, t4, t5, t6, t7;
+    int row_end = row + p->tile_rows < N ? row + p->tile_rows : N;
+    int col_end = col + p->tile_cols < M ? col + p->tile_cols : M;
+
+    for (i = row; i < row_end; i++) {
+        j = col;
+        if (p->diag == DIAG_LOCALS) {
+            for (; j + 8 <= col_end; j += 8) {
+                t0 = A[i][j];
+                t1 = A[i][j + 1];
+                t2 = A[i][j + 2];
+                t3 = A[i][j + 3];
+                t4 = A[i][j + 4];
+                t5 = A[i][j + 5];
+                t6 = A[i][j + 6];
+                t7 = A[i][j + 7];
+                B[j][i] = t0;
+                B[j + 1][i] = t1;
+                B[j + 2][i] = t2;
+                B[j + 3][i] = t3;
+                B[j + 4][i] = t4;
+                B[j + 5][i] = t5;
+                B[j + 6][i] = t6;
+                B[j + 7][i] = t7;
+            }
+        }
+        for (; j < col_end; j++) {
+            if (p->diag != DIAG_NONE && i == j)
+                continue;
+            t0 = A[i][j];
+            B[j][i] = t0;
+        }
+        // handle diagonal element after the tile row (or its leftover columns)
+        if (p->diag != DIAG_NONE && i < col_end &&
+            i >= (p->diag == DIAG_LOCALS ? col_end - (col_end - col) % 8 : col)) {
+            t0 = A[i][i];
+            B[i][i] = t0;
+        }
+    }
+}
+
+/* 
+ * transpose_blocked - Blocked transpose driven by a parameter set, the
+ *     kernel that the autotuner searches over
+ */
+void transpose_blocked(int M, int N, int A[N][M], int B[M][N],
+                       const struct trans_params *p)
+{
+    int row, col;
+
+    REQUIRES(p->tile_rows > 0 && p->tile_cols > 0);
+
+    if (p->order == 0) {
+        for (row = 0; row < N; row += p->tile_rows)
+            for (col = 0; col < M; col += p->tile_cols)
+                blocked_tile(M, N, A, B, p, row, col);
+    } else {
+        for (col = 0; col < M; col += p->tile_cols)
+            for (row = 0; row < N; row += p->tile_rows)
+                blocked_tile(M, N, A, B, p, row, col);
+    }
+
+    ENSURES(is_transpose(M, N, A, B));
+}
+
+/* 
+ * transpose_tuned - Blocked transpose using the parameters the
+ *     autotuner picked for this shape in trans-tuned.h, or 8x8 tiles
+ *     with deferred diagonals for shapes it has not seen.
+ */
+char transpose_tuned_desc[] = "Autotuned blocked transpose";
+void transpose_tuned(int M, int N, int A[N][M], int B[M][N])
+{
+    static const struct trans_params fallback = {0, 0, 8, 8, 0, DIAG_DEFER};
+    const struct trans_params *p = &fallback;
+    int i;
+
+    for (i = 0; i < sizeof(tuned_params) / sizeof(tuned_params[0]); i++) {
+        if (tuned_params[i].M == M && tuned_params[i].N == N)
+            p = &tuned_params[i];
+    }
+    transpose_blocked(M, N, A, B, p);
+}
+
+/* 
+ * recursive_block - Transpose rows [row, row_end) and columns
+ *     [col, col_end) of A, halving the longer side until the block is no
+ *     bigger than recursive_base on either side. Halves are cut on a
+ *     multiple of recursive_base so base blocks stay line aligned.
+ */
+static void recursive_block(int M, int N, int A[N][M], int B[M][N],
+                            int row, int row_end, int col, int col_end)
+{
+    int i, j, tmp, half;
+    int rows = row_end - row, cols = col_end - col;
+
+    if (rows > recursive_base || cols > recursive_base) {
+        if (rows >= cols) {
+            half = (rows / 2 + recursive_base - 1) / recursive_base * recursive_base;
+            recursive_block(M, N, A, B, row, row + half, col, col_end);
+            recursive_block(M, N, A, B, row + half, row_end, col, col_end);
+        } else {
+            half = (cols / 2 + recursive_base - 1) / recursive_base * recursive_base;
+            recursive_block(M, N, A, B, row, row_end, col, col + half);
+            recursive_block(M, N, A, B, row, row_end, col + half, col_end);
+        }
+        return;
+    }
+
+    for (i = row; i < row_end; i++) {
+        for (j = col; j < col_end; j++) {
+            if (i != j) {
+                tmp = A[i][j];
+                B[j][i] = tmp;
+            }
+        }
+        // handle diagonal element after the row, as in transpose_submit
+        if (i >= col && i < col_end) {
+            tmp = A[i][i];
+            B[i][i] = tmp;
+        }
+    }
+}
+
+/* 
+ * transpose_recursive - Cache-oblivious transpose. Recursive halving
+ *     makes some level of blocks fit whatever cache it runs on, so it
+ *     needs no shape- or cache-specific code. Set recursive_base to
+ *     change the size at which it stops dividing.
+ */
+int recursive_base = 8;
+char transpose_recursive_desc[] = "Cache-oblivious recursive transpose";
+void transpose_recursive(int M, int N, int A[N][M], int B[M][N])
+{
+    REQUIRES(M > 0);
+    REQUIRES(N > 0);
+    REQUIRES(recursive_base > 0);
+
+    recursive_block(M, N, A, B, 0, N, 0, M);
+
+    ENSURES(is_transpose(M, N, A, B));
+}
+
+#ifdef HAVE_SIMD_TRANS
+/* 
+ * scalar_edge - Transpose the rows [row, N) and the columns [col, M)
+ *     left over by a SIMD kernel, one element at a time
+ */
+static void scalar_edge(int M, int N, int A[N][M], int B[M][N], int row, int col)
+{
+    int i, j;
+
+    for (i = 0; i < N; i++)
+        for (j = (i < row ? col : 0); j < M; j++)
+            B[j][i] = A[i][j];
+}
+
+/* 
+ * transpose_sse2 - Transpose 4x4 tiles in SSE2 registers: four row loads
+ *     of A, two rounds of 32- and 64-bit unpacks, four row stores of B
+ */
+char transpose_sse2_desc[] = "SSE2 4x4 register transpose";
+void transpose_sse2(int M, int N, int A[N][M], int B[M][N])
+{
+    int row, col;
+    __m128i r0, r1, r2, r3, t0, t1, t2, t3;
+
+    for (row = 0; row + 4 <= N; row += 4) {
+        for (col = 0; col + 4 <= M; col += 4) {
+            r0 = _mm_loadu_si128((__m128i *)&A[row][col]);
+            r1 = _mm_loadu_si128((__m128i *)&A[row + 1][col]);
+            r2 = _mm_loadu_si128((__m128i *)&A[row + 2][col]);
+            r3 = _mm_loadu_si128((__m128i *)&A[row + 3][col]);
+            t0 = _mm_unpacklo_epi32(r0, r1);
+            t1 = _mm_unpackhi_epi32(r0, r1);
+            t2 = _mm_unpacklo_epi32(r2, r3);
+            t3 = _mm_unpackhi_epi32(r2, r3);
+            _mm_storeu_si128((__m128i *)&B[col][row], _mm_unpacklo_epi64(t0, t2));
+            _mm_storeu_si128((__m128i *)&B[col + 1][row], _mm_unpackhi_epi64(t0, t2));
+            _mm_storeu_si128((__m128i *)&B[col + 2][row], _mm_unpacklo_epi64(t1, t3));
+            _mm_storeu_si128((__m128i *)&B[col + 3][row], _mm_unpackhi_epi64(t1, t3));
+        }
+    }
+    scalar_edge(M, N, A, B, N / 4 * 4, M / 4 * 4);
+
+    ENSURES(is_transpose(M, N, A, B));
+}
+
+/* 
+ * transpose_avx2 - Transpose 8x8 tiles in AVX2 registers: eight row
+ *     loads of A, 32- and 64-bit unpacks within each 128-bit lane, then
+ *     a lane swap, and eight row stores of B
+ */
+char transpose_avx2_desc[] = "AVX2 8x8 register transpose";
+__attribute__((target("avx2")))
+void transpose_avx2(int M, int N, int A[N][M], int B[M][N])
+{
+    int row, col, k;
+    __m256i r[8], t[8], u[8];
+
+    for (row = 0; row + 8 <= N; row += 8) {
+        for (col = 0; col + 8 <= M; col += 8) {
+            for (k = 0; k < 8; k++)
+                r[k] = _mm256_loadu_si256((__m256i *)&A[row + k][col]);
+            for (k = 0; k < 8; k += 2) {
+                t[k] = _mm256_unpacklo_epi32(r[k], r[k + 1]);
+                t[k + 1] = _mm256_unpackhi_epi32(r[k], r[k + 1]);
+            }
+            for (k = 0; k < 8; k += 4) {
+                u[k] = _mm256_unpacklo_epi64(t[k], t[k + 2]);
+                u[k + 1] = _mm256_unpackhi_epi64(t[k], t[k + 2]);
+                u[k + 2] = _mm256_unpacklo_epi64(t[k + 1], t[k + 3]);
+                u[k + 3] = _mm256_unpackhi_epi64(t[k + 1], t[k + 3]);
+            }
+            for (k = 0; k < 4; k++) {
+                _mm256_storeu_si256((__m256i *)&B[col + k][row],
+                                    _mm256_permute2x128_si256(u[k], u[k + 4], 0x20));
+                _mm256_storeu_si256((__m256i *)&B[col + k + 4][row],
+                                    _mm256_permute2x128_si256(u[k], u[k + 4], 0x31));
+            }
+        }
+    }
+    scalar_edge(M, N, A, B, N / 8 * 8, M / 8 * 8);
+
+    ENSURES(is_transpose(M, N, A, B));
+}
+#endif
+
 /*
  * registerFunctions - This function registers your transpose
  *     functions with the driver.  At runtime, the driver will
@@ -165,6 +409,13 @@ void registerFunctions()
 
     /* Register any additional transpose functions */
     registerTransFunction(trans, trans_desc); 
+    registerTransFunction(transpose_tuned, transpose_tuned_desc); 
+    registerTransFunction(transpose_recursive, transpose_recursive_desc); 
+#ifdef HAVE_SIMD_TRANS
+    registerTransFunction(transpose_sse2, transpose_sse2_desc); 
+    if (__builtin_cpu_supports("avx2"))
+        registerTransFunction(transpose_avx2, transpose_avx2_desc); 
+#endif
 
 }
 
@@ -3,10 +3,11 @@
  * Andrew ID: pans
  *
  * Data Structure
- * 1.Type: Segregated free lists
- * 2.Algorithms: First fit
+ * 1.Type: Two-level segregated free lists (TLSF)
+ * 2.Algorithms: Good fit in O(1), see the size classes below
  * 3.Structure of the whole heap:
- * | free list root pointers | prologue | heap blocks | epilogue |
+ * | second-level bitmaps | free list root pointers | prologue |
+ * | heap blocks | epilogue |
  * 4.Structure of allocated blocks:
  * | header | content | footer |
  * 5.Structure of free blocks:
@@ -65,7 +66,7 @@
 #define MINI_SIZE 24 
 #define WSIZE 4 // Word and header/footer size (bytes)
 #define DSIZE 8 // Doubleword size (bytes)
-#define NUM_FREE_LISTS 18
+#define ALIGN_SHIFT 3 // log2 of ALIGNMENT
 #define ALIGNMENT 8
 #define CHUNKSIZE 400
 
@@ -96,45 +97,47 @@ static int in_heap(void* p) {
 }
 
 /*
- * This determines which free list a block is added to
- */
-static int get_seglist_no(size_t asize){
-    if (asize <= 24)
-        return 0;
-    else if (asize <= 48)
-        return 1;
-    else if (asize <= 72)
-        return 2;
-    else if (asize <= 96)
-        return 3;
-    else if (asize <= 120)
-        return 4;
-    else if (asize <= 144)
-        return 5;
-    else if (asize <= 168)
-        return 6;
-    else if (asize <= 192)
-        return 7;
-    else if (asize <= 216)
-        return 8;
-    else if (asize <= 240)
-        return 9;
-    else if (asize <= 480)
-        return 10;
-    else if (asize <= 960)
-        return 11;
-    else if (asize <= 1920)
-        return 12;
-    else if (asize <= 3840)
-        return 13;
-    else if (asize <= 7680)
-        return 14;
-    else if (asize <= 15360)
-        return 15;
-    else if (asize <= 30720)
-        return 16;
-    else
-        return 17;
+ *  Size classes
+ *  ------------
+ *  A free block of size s lives in list (fl, sl). The first level fl
+ *  is the power of two below s, the second level sl splits each power
+ *  of two into SL_COUNT equal ranges. Sizes below SMALL_SIZE all share
+ *  fl 0 and are split into exact ALIGNMENT steps instead. A bit per
+ *  first level says whether any of its lists is non-empty, and a bit
+ *  per list in its second-level bitmap says whether it is non-empty,
+ *  so a non-empty list of a given class or above is found with one or
+ *  two find-first-set instructions, whatever is on the lists.
+ */
+
+#define SL_SHIFT 2 // log2 of SL_COUNT
+#define SL_COUNT (1 << SL_SHIFT)
+#define FL_SHIFT (SL_SHIFT + ALIGN_SHIFT)
+#define SMALL_SIZE (1 << FL_SHIFT)
+/* enough first levels for any size a 32-bit header can hold */
+#define FL_COUNT (32 - FL_SHIFT + 1)
+#define NUM_FREE_LISTS (FL_COUNT * SL_COUNT)
+/* the bitmaps take whole double words to keep the blocks aligned */
+#define SL_BITMAP_BYTES ((FL_COUNT + DSIZE - 1) & ~(DSIZE - 1))
+
+/*
+ * Index of the most significant set bit of size, size > 0
+ */
+static inline int log2_floor(size_t size) {
+    return 31 - __builtin_clz((uint32_t)size);
+}
+
+/*
+ * This determines which free list a block of size asize is added to
+ */
+static inline void mapping_insert(size_t asize, int* fl, int* sl) {
+    if (asize < SMALL_SIZE) {
+        *fl = 0;
+        *sl = asize >> ALIGN_SHIFT;
+    } else {
+        int msb = log2_floor(asize);
+        *fl = msb - FL_SHIFT + 1;
+        *sl = (asize >> (msb - SL_SHIFT)) ^ SL_COUNT;
+    }
 }
 
 /*
@@ -258,6 +261,7 @@ static inline void set_size(void* block, size_t size, size_t alloc){
 }
 
 static int get_free_list_index(size_t size);
+static void* find_suitable_list(int fl, int sl);
 static void* find_free_block(size_t size);
 static void* extend_heap(size_t size);
 static void remove_block(void* block);
@@ -279,6 +283,8 @@ static void print_block(void *bp);
  */
 
 static void** free_lists;
+static uint8_t* sl_bitmaps;  // one byte of SL_COUNT bits per first level
+static uint32_t fl_bitmap;   // bit fl set if first level fl has a free block
 static void* heap_start;
 
 /*
@@ -289,15 +295,19 @@ static void* heap_start;
 
 /*
  * Initialize: return -1 on error, 0 on success.
- * Allocates space for free list pointers.
+ * Allocates space for the bitmaps and free list pointers.
  * Sets each to point to NULL which means the end of the list.
  */
 int mm_init(void) {
     void** current;
     /* create the initial empty heap */ 
+    if ((sl_bitmaps = mem_sbrk(SL_BITMAP_BYTES)) == (void *) - 1)
+        return -1;
     if ((free_lists = mem_sbrk(NUM_FREE_LISTS * DSIZE)) \
         == (void *) - 1)
         return -1;
+    memset(sl_bitmaps, 0, SL_BITMAP_BYTES);
+    fl_bitmap = 0;
     current = free_lists;
     for (int i = 0; i < NUM_FREE_LISTS; i++) {
         *current = NULL;
@@ -325,8 +335,9 @@ void *malloc (size_t size) {
     void *bp;
     if (heap_start == 0) mm_init();
     if (size == 0) return NULL;
-    /* Adjust block size */
-        asize = ((size_t)(size + DSIZE) + (ALIGNMENT-1)) & ~0x7;
+    /* Adjust block size, a free block must hold its list pointers */
+    asize = ((size_t)(size + DSIZE) + (ALIGNMENT-1)) & ~0x7;
+    if (asize < MINI_SIZE) asize = MINI_SIZE;
     /* Search the free list for a fit */
     if ((bp = find_free_block(asize)) != NULL) {
         place(bp, asize);
@@ -399,37 +410,54 @@ void* calloc (size_t nmemb, size_t size) {
  */
 
 /* 
- * Returns the index for a free list 
- * with a block to fit the size request
+ * Returns the index of the free list a block of this size belongs to
  */
 static int get_free_list_index(size_t size){
-    int index = 0;
-    index = get_seglist_no(size);
+    int fl, sl;
+    mapping_insert(size, &fl, &sl);
 
-    ENSURES(0 <= index && index < NUM_FREE_LISTS);
-    return index;
+    ENSURES(0 <= fl && fl < FL_COUNT && 0 <= sl && sl < SL_COUNT);
+    return fl * SL_COUNT + sl;
+}
+
+/*
+ * Returns the head of the first non-empty list in class (fl, sl)
+ * or above, NULL if there is none
+ */
+static void* find_suitable_list(int fl, int sl){
+    uint32_t sl_map = sl_bitmaps[fl] & (~0U << sl);
+    if (sl_map == 0) {
+        /* nothing left on this first level, go to the next one up */
+        uint32_t fl_map = fl_bitmap & (~0U << (fl + 1));
+        if (fl_map == 0)
+            return NULL;
+        fl = __builtin_ffs(fl_map) - 1;
+        sl_map = sl_bitmaps[fl];
+    }
+    sl = __builtin_ffs(sl_map) - 1;
+    return free_lists[fl * SL_COUNT + sl];
 }
 
 /* 
- * Returns a pointer if block of sufficient size is available 
- * will allocate a new block if none are free
+ * Returns a pointer if block of sufficient size is available,
+ * NULL if the heap has to be extended.
+ * The head of the size's own list is tried first. Otherwise the size
+ * is rounded up to the next class, where every block fits, so no
+ * list is ever walked.
  */
 static void* find_free_block(size_t size){
     void *bp;
-    size_t asize;
-    int index = get_free_list_index(size);
-    /* first fit search */
-    for (int i = index; i < NUM_FREE_LISTS; i++) {
-        bp = free_lists[i];
-        while (bp != NULL) {
-            asize = block_size(bp);
-            if (size <= asize) {
-                return bp;
-            }
-            bp = block_next(bp);
-        }
-    }
-    return NULL;
+    int fl, sl;
+    /* no block is that large */
+    if (size > UINT32_MAX - (UINT32_MAX >> SL_SHIFT))
+        return NULL;
+    bp = free_lists[get_free_list_index(size)];
+    if (bp != NULL && block_size(bp) >= size)
+        return bp;
+    if (size >= SMALL_SIZE)
+        size += (1 << (log2_floor(size) - SL_SHIFT)) - 1;
+    mapping_insert(size, &fl, &sl);
+    return find_suitable_list(fl, sl);
 }
 
 /*
@@ -458,7 +486,16 @@ static void remove_block(void* bp){
     int index = get_free_list_index(block_size(bp));
     void *next = block_next(bp);
     void *prev = block_prev(bp);
-    if (bp == free_lists[index]) free_lists[index] = next;
+    if (bp == free_lists[index]) {
+        free_lists[index] = next;
+        /* the list is empty now, clear its bits */
+        if (next == NULL) {
+            int fl = index / SL_COUNT;
+            sl_bitmaps[fl] &= ~(1U << (index % SL_COUNT));
+            if (sl_bitmaps[fl] == 0)
+                fl_bitmap &= ~(1U << fl);
+        }
+    }
     if(prev != NULL) set_next_pointer(prev, next);
     if(next != NULL) set_prev_pointer(next, prev);
     set_prev_pointer(bp, NULL);
@@ -477,6 +514,8 @@ static void* add_block_to_list(void* bp){
     if(free_lists[index] == NULL){
         set_prev_pointer(bp, NULL);
         set_next_pointer(bp, NULL);
+        sl_bitmaps[index / SL_COUNT] |= 1U << (index % SL_COUNT);
+        fl_bitmap |= 1U << (index / SL_COUNT);
     }
     /* set as the head */
     else {
@@ -598,6 +637,7 @@ static void check_heap_head(int verbose, void* bp){
  * Check alignment
  * Count free blocks and check if match
  * Check size range
+ * Check the bitmaps match the lists
  */
 static void check_free_list(int verbose){
     void* bp;
@@ -607,6 +647,14 @@ static void check_free_list(int verbose){
     int free_blocks_count = 0;
     for (int i = 0; i < NUM_FREE_LISTS; i++) {
         bp = free_lists[i];
+        /* Check the list's bit and its first level's bit */
+        if (!(sl_bitmaps[i / SL_COUNT] & (1U << (i % SL_COUNT))) != (bp == NULL)) {
+            printf("LIST ERROR: bitmap wrong for list %d\n", i);
+        }
+        if (!(fl_bitmap & (1U << (i / SL_COUNT))) != \
+            (sl_bitmaps[i / SL_COUNT] == 0)) {
+            printf("LIST ERROR: first-level bitmap wrong for list %d\n", i);
+        }
         while ((bp != NULL) && (block_size(bp)) > 0) {
             if (!in_heap(bp)) {
                 printf("LIST ERROR: %p not in heap\n", bp);